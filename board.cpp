@@ -1,9 +1,10 @@
-#include <sstream>
-#include <istream>
+#include <iostream>
+#include <cstdio>
 
 #include <algorithm>
 #include <functional>
 #include <queue>
+#include <stdexcept>
 
 #include "board.h"
 #include "termcolor.h"
@@ -22,128 +23,210 @@ const char* piece_to_string(int8_t piece) {
 	}
 }
 
-Board::Board() {
-	bzero(this, sizeof(Board));
+template<int N>
+BoardT<N>::BoardT() {
+	bzero(this, sizeof(BoardT));
 	moveno = 0;
 	playerTurn = 1;
 
-	capstones[0] = 1;
-	capstones[1] = 1;
+	capstones[0] = CAPSTONES_PER_SIDE;
+	capstones[1] = CAPSTONES_PER_SIDE;
 	piecesleft[0] = PIECES_PER_SIDE;
 	piecesleft[1] = PIECES_PER_SIDE;
 }
 
-Board::Board(const std::string& tbgEncoding) : Board() {
-	std::string encoding(tbgEncoding);
-	std::transform(encoding.begin(), encoding.end(), encoding.begin(), ::tolower);
-	std::replace(encoding.begin(), encoding.end(), ';', ',');
-
-	std::string segment;
-	std::istringstream ss(encoding);
-
-	int i = 0;
-
-	while (std::getline(ss, segment, ',')) {
-		i++;
-		if (i == 1) {
-			this->moveno = std::stoi(segment);
-		} else if (i == 2) {
-			if (segment == "w") {
-				this->playerTurn = 1;
-			} else if (segment == "b") {
-				this->playerTurn = -1;
-			} else {
-				std::cerr << "invalid current player turn '" << segment << std::endl;
-				exit(1); // TODO: learn about throwing exceptions
+template<int N>
+BoardT<N>::BoardT(const std::string& tbgEncoding) : BoardT() {
+	TBGError error = parseTBG(tbgEncoding.c_str(), tbgEncoding.length(), this);
+	if (error != TBG_OK)
+		throw std::invalid_argument(tbgErrorString(error));
+}
+
+/**
+	TBG encoding: moveno,turn,size,white pieces,black pieces,white caps,black caps;stack,stack,...
+	every stack lists its pieces bottom to top by color followed by the kind of the top piece e.g. wbwF.
+	either separator is accepted anywhere and letters are case insensitive.
+*/
+static inline bool isTBGSeparator(char c) {
+	return c == ',' || c == ';';
+}
+
+static bool parseTBGInt(const char*& p, const char* end, int* value) {
+	if (p == end || *p < '0' || *p > '9') return false;
+	int result = 0;
+	while (p != end && *p >= '0' && *p <= '9') {
+		result = result * 10 + (*p - '0');
+		if (result > 1000000) return false;
+		p++;
+	}
+	*value = result;
+	return true;
+}
+
+static bool skipTBGSeparator(const char*& p, const char* end) {
+	if (p == end || !isTBGSeparator(*p)) return false;
+	p++;
+	return true;
+}
+
+template<int N>
+typename BoardT<N>::TBGError BoardT<N>::parseTBG(const char* str, size_t length, BoardT* board) {
+	const char* p = str;
+	const char* end = str + length;
+	while (end != p && (end[-1] == '\n' || end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t'))
+		end--;
+
+	BoardT result;
+
+	if (!parseTBGInt(p, end, &result.moveno) || !skipTBGSeparator(p, end)) return TBG_BAD_NUMBER;
+
+	if (p == end) return TBG_BAD_TURN;
+	switch (*p++ | 0x20) {
+	case 'w': result.playerTurn = 1; break;
+	case 'b': result.playerTurn = -1; break;
+	default: return TBG_BAD_TURN;
+	}
+	if (!skipTBGSeparator(p, end)) return TBG_BAD_TURN;
+
+	int size;
+	if (!parseTBGInt(p, end, &size) || !skipTBGSeparator(p, end)) return TBG_BAD_NUMBER;
+	if (size != SIZE) return TBG_BAD_SIZE;
+
+	int* counts[4] = {&result.piecesleft[0], &result.piecesleft[1], &result.capstones[0], &result.capstones[1]};
+	for (int* count : counts) {
+		if (!parseTBGInt(p, end, count) || !skipTBGSeparator(p, end)) return TBG_BAD_NUMBER;
+	}
+
+	for (int square = 0; square < SQUARES; ++square) {
+		const char* segment = p;
+		while (p != end && !isTBGSeparator(*p)) p++;
+		const int len = p - segment;
+
+		if (square + 1 < SQUARES) {
+			if (!skipTBGSeparator(p, end)) return TBG_BAD_SQUARE_COUNT;
+		} else if (p != end) {
+			return TBG_BAD_SQUARE_COUNT;
+		}
+
+		if (len == 0) continue;
+		if (len < 2 || len > STACK_CAPACITY + 1) return TBG_BAD_STACK;
+
+		for (int i = 0; i < len - 1; ++i) {
+			int8_t color;
+			switch (segment[i] | 0x20) {
+			case 'w': color = 1; break;
+			case 'b': color = -1; break;
+			default: return TBG_BAD_STACK;
 			}
-		} else if (i == 3) {
-			assert(std::stoi(segment) == Board::SIZE);
-		} else if (i == 4) {
-			this->piecesleft[0] = std::stoi(segment);
-		} else if (i == 5) {
-			this->piecesleft[1] = std::stoi(segment);
-		} else if (i == 6) {
-			this->capstones[0] = std::stoi(segment);
-		} else if (i == 7) {
-			this->capstones[1] = std::stoi(segment);
-		} else {
-			int stack = i - 8;
-			if (segment.length() >= 2) {
-				for (size_t i = 0; i < segment.length() - 2; ++i) {
-					if (segment[i] == 'b')
-						place(stack, -PIECE_FLAT);
-					else if (segment[i] == 'w')
-						place(stack, PIECE_FLAT);
-				}
-				int8_t team = segment[segment.length() - 2] == 'w' ? 1 : -1;
-				switch (segment[segment.length() - 1]) {
-				case 'f': place(stack, team * PIECE_FLAT); break ;
-				case 's': place(stack, team * PIECE_WALL); break ;
-				case 'c': place(stack, team * PIECE_CAP); break ;
-				default:
-					std::cerr << "invalid piece type on top of stack. error" << std::endl;
-					exit(1);
+
+			int8_t piece = PIECE_FLAT;
+			if (i == len - 2) {
+				switch (segment[len - 1] | 0x20) {
+				case 'f': piece = PIECE_FLAT; break;
+				case 's': piece = PIECE_WALL; break;
+				case 'c': piece = PIECE_CAP; break;
+				default: return TBG_BAD_STACK;
 				}
 			}
+			result.place(square, color * piece);
 		}
 	}
+
+	*board = result;
+	return TBG_OK;
 }
 
-std::string Board::toTBGEncoding() const {
-	std::stringstream ss;
+template<int N>
+const char* BoardT<N>::tbgErrorString(TBGError error) {
+	switch (error) {
+	case TBG_OK: return "ok";
+	case TBG_BAD_NUMBER: return "malformed number in TBG encoding";
+	case TBG_BAD_TURN: return "invalid player turn in TBG encoding";
+	case TBG_BAD_SIZE: return "unsupported board size in TBG encoding";
+	case TBG_BAD_STACK: return "invalid stack in TBG encoding";
+	case TBG_BAD_SQUARE_COUNT: return "wrong number of squares in TBG encoding";
+	default: return "unknown TBG error";
+	}
+}
 
-	ss << moveno << "," << (playerTurn > 0 ? "w" : "b") << "," << SIZE << ",";
-	ss << piecesleft[0] << "," << piecesleft[1] << "," << capstones[0] << "," << capstones[1];
+template<int N>
+size_t BoardT<N>::writeTBG(char* buffer, size_t size) const {
+	size_t n = 0;
+	auto put = [&](char c) {
+		if (n + 1 < size) buffer[n] = c;
+		n++;
+	};
+	auto putInt = [&](int value) {
+		char digits[12];
+		int count = 0;
+		if (value < 0) {
+			put('-');
+			value = -value;
+		}
+		do {
+			digits[count++] = '0' + value % 10;
+			value /= 10;
+		} while (value);
+		while (count) put(digits[--count]);
+	};
 
-	bool isFirst = true;
+	putInt(moveno);
+	put(',');
+	put(playerTurn > 0 ? 'w' : 'b');
+	put(',');
+	putInt(SIZE);
+	for (int count : {piecesleft[0], piecesleft[1], capstones[0], capstones[1]}) {
+		put(',');
+		putInt(count);
+	}
 
-	for (int y = 0; y < 5; ++y) {
-		for (int x = 0; x < 5; ++x) {
-			ss << (isFirst ? ";" : ",");
-			isFirst = false;
-			const Stack& stack = stacks[x + y * Board::SIZE];
-			for (int i = 0; i < stack.size(); ++i) {
-				if (stack.stack()[i])
-					ss << "w";
-				else
-					ss << "b";
-			}
-			if (stack.size() >= 1) {
-				switch (stack.top()) {
-				case PIECE_FLAT:
-				case -PIECE_FLAT: ss << "F"; break ;
-				case PIECE_WALL:
-				case -PIECE_WALL: ss << "S"; break ;
-				case PIECE_CAP:
-				case -PIECE_CAP: ss << "C"; break ;
-				}
-			}
+	for (int i = 0; i < SQUARES; ++i) {
+		put(i == 0 ? ';' : ',');
+		const Stack& stack = stacks[i];
+		for (int j = 0; j < stack.size(); ++j)
+			put(stack.isWhite(j) ? 'w' : 'b');
+		switch (stack.top()) {
+		case PIECE_FLAT:
+		case -PIECE_FLAT: put('F'); break ;
+		case PIECE_WALL:
+		case -PIECE_WALL: put('S'); break ;
+		case PIECE_CAP:
+		case -PIECE_CAP: put('C'); break ;
 		}
 	}
 
-	return ss.str();
+	if (size > 0) buffer[n < size ? n : size - 1] = 0;
+	return n;
 }
 
-std::ostream& operator << (std::ostream& out, const Board& board) {
+template<int N>
+std::string BoardT<N>::toTBGEncoding() const {
+	char buffer[TBG_MAX_LENGTH];
+	size_t length = writeTBG(buffer, sizeof(buffer));
+	return std::string(buffer, length);
+}
+
+template<int N>
+std::ostream& operator << (std::ostream& out, const BoardT<N>& board) {
 	out << "Move #" << board.moveno << "   " << (board.playerTurn > 0 ? "Black moved. White turn." : "White moved. Black turn.") << std::endl;
 
 	bool useColors = &out == &std::cout;
 
 	char buffer[80];
 	out << "  ";
-	for (int i = 0; i < Board::SIZE; ++i) {
+	for (int i = 0; i < N; ++i) {
 		sprintf(buffer, "%15c", 'A' + i);
 		out << buffer;
 	}
 	out << std::endl;
 
-	for (int y = 0; y < Board::SIZE; ++y) {
+	for (int y = 0; y < N; ++y) {
 		out << y + 1 << " ";
-		for (int x = 0; x < Board::SIZE; ++x) {
+		for (int x = 0; x < N; ++x) {
 			out << "|";
-			const Stack& stack = board.stacks[x + y * Board::SIZE];
+			const typename BoardT<N>::Stack& stack = board.stacks[x + y * N];
 			for (int i = 0; i < stack.size() - 1; ++i) {
-				if (stack.stack()[i]) {
+				if (stack.isWhite(i)) {
 					if (useColors) out << termcolor::white << "+";
 					else out << "w";
 				}
@@ -173,26 +256,110 @@ std::ostream& operator << (std::ostream& out, const Board& board) {
 	return out;
 };
 
-int Board::getWinner() const {
-	int djikstraWhite = this->getDjikstraScore(1);
-	if (djikstraWhite == 0) return 1;
-	int djikstraBlack = this->getDjikstraScore(-1);
-	if (djikstraBlack == 0) return -1;
+/**
+	bitboard road detection
+*/
+template<int N>
+constexpr uint64_t boardColumn(int x, int y = 0) {
+	return y == N ? 0 : (1ULL << INDEX_BOARD(x, y, N)) | boardColumn<N>(x, y + 1);
+}
+
+template<int N>
+struct boardMasks {
+	static constexpr uint64_t FIRST_ROW = (1ULL << N) - 1;
+	static constexpr uint64_t LAST_ROW = FIRST_ROW << (N * N - N);
+	static constexpr uint64_t FIRST_COLUMN = boardColumn<N>(0);
+	static constexpr uint64_t LAST_COLUMN = boardColumn<N>(N - 1);
+};
+
+template<int N>
+struct boardNeighbors {
+	// NOTE: bits shifted past the last square are dropped by the path mask in squaresAreConnected
+	uint64_t operator()(uint64_t bits) const {
+		return ((bits & ~boardMasks<N>::LAST_COLUMN) << 1) | ((bits & ~boardMasks<N>::FIRST_COLUMN) >> 1) |
+			(bits << N) | (bits >> N);
+	}
+};
+
+template<int N>
+uint64_t BoardT<N>::roadBits(int player) const {
+	uint64_t bits = 0;
+	for (int i = 0; i < SQUARES; ++i) {
+		int8_t top = stacks[i].top() * player;
+		if (top == PIECE_FLAT || top == PIECE_CAP)
+			bits |= 1ULL << i;
+	}
+	return bits;
+}
+
+template<int N>
+bool BoardT<N>::hasRoad(int player) const {
+	typedef boardMasks<N> masks;
+	uint64_t road = roadBits(player);
+	return squaresAreConnected<boardNeighbors<N>>(masks::FIRST_ROW, masks::LAST_ROW, road) ||
+		squaresAreConnected<boardNeighbors<N>>(masks::FIRST_COLUMN, masks::LAST_COLUMN, road);
+}
+
+// all squares of the path reachable from the seed squares
+template<int N>
+static uint64_t floodFill(uint64_t seed, uint64_t path) {
+	seed &= path;
+	while (true) {
+		uint64_t next = (seed | boardNeighbors<N>()(seed)) & path;
+		if (next == seed) return seed;
+		seed = next;
+	}
+}
+
+template<int N>
+uint64_t BoardT<N>::roadThreats(int player) const {
+	typedef boardMasks<N> masks;
+	uint64_t road = roadBits(player);
+	uint64_t empty = 0;
+	for (int i = 0; i < SQUARES; ++i) {
+		if (stacks[i].top() == 0)
+			empty |= 1ULL << i;
+	}
+
+	const uint64_t edges[2][2] = {{masks::FIRST_ROW, masks::LAST_ROW}, {masks::FIRST_COLUMN, masks::LAST_COLUMN}};
+
+	// a square completes a road if it touches (or is on) both edges through the player's pieces
+	uint64_t threats = 0;
+	for (const uint64_t* edge : edges) {
+		uint64_t reachFirst = floodFill<N>(edge[0], road);
+		uint64_t reachLast = floodFill<N>(edge[1], road);
+		threats |= (edge[0] | boardNeighbors<N>()(reachFirst)) & (edge[1] | boardNeighbors<N>()(reachLast));
+	}
+
+	return threats & empty;
+}
+
+template<int N>
+int BoardT<N>::getWinner() const {
+	if (hasRoad(1)) return 1;
+	if (hasRoad(-1)) return -1;
 	if (piecesleft[0] == 0 || piecesleft[1] == 0) {
-		int count = 0;
-		for (int i : range(0, Board::SQUARES)) {
-			if (stacks[i].top() != 0)
-				count += stacks[i].top() > 0 ? 1 : -1;
-		}
+		int count = flatDifference();
 		if (count == 0) return playerTurn;
 		return count > 0 ? 1 : -1;
 	}
 	return 0;
 }
 
+template<int N>
+int BoardT<N>::flatDifference() const {
+	int count = 0;
+	for (int i : range(0, SQUARES)) {
+		if (stacks[i].top() != 0)
+			count += stacks[i].top() > 0 ? 1 : -1;
+	}
+	return count;
+}
+
 /**
 	djikstra's algorithm based scoring function
 */
+template<int N>
 struct djknode {
 	const static int16_t max_dist = INT16_MAX;
 	bool visited = false;
@@ -203,8 +370,8 @@ struct djknode {
 
 	template<int8_t dx, int8_t dy, typename T>
 	void visit_neighbor(djknode* grid, T& queue) {
-		if (x + dx >= 0 && x + dx < Board::SIZE && y + dy >= 0 && y + dy < Board::SIZE) {
-			int ind = INDEX_BOARD(x + dx, y + dy);
+		if (x + dx >= 0 && x + dx < N && y + dy >= 0 && y + dy < N) {
+			int ind = N * (y + dy) + x + dx;
 			if (!grid[ind].visited) {
 				int8_t distTentative = grid[ind].cost + distance;
 				if (distTentative < grid[ind].distance) {
@@ -225,36 +392,37 @@ struct djknode {
 	}
 };
 
-int getShortestPath(int16_t costs[Board::SQUARES]) {
-	djknode graph[Board::SQUARES];
+template<int N>
+int getShortestPath(int16_t costs[N * N]) {
+	djknode<N> graph[N * N];
 
-	auto compareFunc = [](djknode* a, djknode* b) {
+	auto compareFunc = [](djknode<N>* a, djknode<N>* b) {
 		return a->distance > b->distance;
 	};
-	std::priority_queue<djknode*, std::vector<djknode*>, decltype(compareFunc)> queue(compareFunc);
+	std::priority_queue<djknode<N>*, std::vector<djknode<N>*>, decltype(compareFunc)> queue(compareFunc);
 
-	for (int i = 0; i < Board::SQUARES; ++i) {
-		graph[i].x = i % Board::SIZE;
-		graph[i].y = i / Board::SIZE;
+	for (int i = 0; i < N * N; ++i) {
+		graph[i].x = i % N;
+		graph[i].y = i / N;
 		graph[i].cost = costs[i];
 		graph[i].distance = INT16_MAX;
 		graph[i].visited = false;
 	}
 
-	for (int i = 0; i < Board::SIZE; ++i) {
+	for (int i = 0; i < N; ++i) {
 		graph[i].distance = graph[i].cost;
 		graph[i].visit_neighbors(graph, queue);
 	}
 
 	while (!queue.empty()) {
-		djknode* top = queue.top();
+		djknode<N>* top = queue.top();
 		queue.pop();
 
 		top->visit_neighbors(graph, queue);
 	}
 
 	int16_t minDist = INT16_MAX;
-	for (int i = Board::SQUARES - Board::SIZE; i < Board::SQUARES; ++i) {
+	for (int i = N * N - N; i < N * N; ++i) {
 		if (graph[i].distance < minDist)
 			minDist = graph[i].distance;
 	}
@@ -262,24 +430,25 @@ int getShortestPath(int16_t costs[Board::SQUARES]) {
 	return minDist;
 }
 
-int Board::getDjikstraScore(int player, int *horizontalDistance, int *verticalDistance) const {
+template<int N>
+int BoardT<N>::getDjikstraScore(int player, int *horizontalDistance, int *verticalDistance) const {
 	int horDist;
 	int vertDist;
 
-	int16_t costsTopBottom[Board::SQUARES];
-	int16_t costsLeftRight[Board::SQUARES];
-	for (int y = 0; y < Board::SIZE; ++y) {
-		for (int x = 0; x < Board::SIZE; ++x) {
-			int8_t top = stacks[INDEX_BOARD(x, y)].top();
+	int16_t costsTopBottom[SQUARES];
+	int16_t costsLeftRight[SQUARES];
+	for (int y = 0; y < N; ++y) {
+		for (int x = 0; x < N; ++x) {
+			int8_t top = stacks[INDEX_BOARD(x, y, N)].top();
 			// TODO: update
 			int16_t cost = (top * player == PIECE_FLAT || top * player == PIECE_CAP) ? 0 : 1; // ((top == PIECE_WALL || top == -PIECE_WALL) ? 1 : 1);
-			costsTopBottom[INDEX_BOARD(x, y)] = cost;
-			costsLeftRight[INDEX_BOARD(y, x)] = cost;
+			costsTopBottom[INDEX_BOARD(x, y, N)] = cost;
+			costsLeftRight[INDEX_BOARD(y, x, N)] = cost;
 		}
 	}
 
-	horDist = getShortestPath(costsLeftRight);
-	vertDist = getShortestPath(costsTopBottom);
+	horDist = getShortestPath<N>(costsLeftRight);
+	vertDist = getShortestPath<N>(costsTopBottom);
 
 	if (horizontalDistance)
 		*horizontalDistance = horDist;
@@ -288,3 +457,14 @@ int Board::getDjikstraScore(int player, int *horizontalDistance, int *verticalDi
 
 	return std::min(horDist, vertDist);
 };
+
+#define INSTANTIATE_BOARD(N) \
+	template class BoardT<N>; \
+	template std::ostream& operator << (std::ostream& out, const BoardT<N>& board);
+
+INSTANTIATE_BOARD(3)
+INSTANTIATE_BOARD(4)
+INSTANTIATE_BOARD(5)
+INSTANTIATE_BOARD(6)
+INSTANTIATE_BOARD(7)
+INSTANTIATE_BOARD(8)
@@ -12,28 +12,153 @@
 
 #include "hash.h"
 
-// NOTE: this will not allow for the possibility of a stack height >48
-
 const int8_t PIECE_FLAT = 1;
 const int8_t PIECE_WALL = 2;
 const int8_t PIECE_CAP = 3;
 
-class Board;
-class Stack;
+template<int N> class BoardT;
 class Move;
 
+typedef BoardT<5> Board;
+
 extern const char * piece_to_string(int8_t);
 
-class Stack {
+/**
+	the rules that change with the size of the board. a stack can at most hold every piece in the game, rounded up to
+	a whole byte
+*/
+template<int N> struct BoardSize;
+template<> struct BoardSize<3> { const static int PIECES = 10; const static int CAPSTONES = 0; const static int STACK_CAPACITY = 24; };
+template<> struct BoardSize<4> { const static int PIECES = 15; const static int CAPSTONES = 0; const static int STACK_CAPACITY = 32; };
+template<> struct BoardSize<5> { const static int PIECES = 21; const static int CAPSTONES = 1; const static int STACK_CAPACITY = 48; };
+template<> struct BoardSize<6> { const static int PIECES = 30; const static int CAPSTONES = 1; const static int STACK_CAPACITY = 64; };
+template<> struct BoardSize<7> { const static int PIECES = 40; const static int CAPSTONES = 2; const static int STACK_CAPACITY = 88; };
+template<> struct BoardSize<8> { const static int PIECES = 50; const static int CAPSTONES = 2; const static int STACK_CAPACITY = 104; };
+
+/**
+	a stack of pieces, the color of every piece from the bottom up is one bit (white is 1) and only the kind of the top
+	piece is kept, everything under it is a flat. stacks that fit in 48 bits pack the colors, the height and the top
+	piece into a single word, larger ones keep as many words of colors as they need
+*/
+template<int CAPACITY, bool PACKED = (CAPACITY <= 48)>
+class StackT;
+
+template<int CAPACITY>
+class StackT<CAPACITY, true> {
 private:
-	int8_t piece_top = 0;
+	const static int HEIGHT_SHIFT = 48;
+	const static int TOP_SHIFT = 56;
+	const static uint64_t COLOR_MASK = (1ull << HEIGHT_SHIFT) - 1;
+
+	// colors in the low 48 bits, then a byte of height and a byte of top piece
+	uint64_t bits = 0;
+
+	inline uint64_t colors() const {
+		return bits & COLOR_MASK;
+	}
+
+	inline static uint64_t pack(uint64_t colors, int height, int8_t top) {
+		return colors | (uint64_t)height << HEIGHT_SHIFT | (uint64_t)(uint8_t)top << TOP_SHIFT;
+	}
+
+	// the flat left on top of the colors, 0 for an empty stack
+	inline static int8_t flatTop(uint64_t colors, int height) {
+		const int white = (colors >> ((height - 1) & 63)) & 1;
+		return (height > 0) * (2 * white - 1) * PIECE_FLAT;
+	}
+public:
+	void push(int8_t piece) {
+		const int height = size();
+		bits = pack(colors() | (uint64_t)(piece > 0) << height, height + 1, piece);
+	}
+
+	inline int8_t top() const {
+		return (int8_t)(bits >> TOP_SHIFT);
+	}
+
+	inline void pop() {
+		assert(size() > 0);
+		const int height = size() - 1;
+		const uint64_t below = colors() & ((1ull << height) - 1);
+		bits = pack(below, height, flatTop(below, height));
+	}
+
+	// moves the top count pieces onto the other stack in the same order
+	inline void moveTop(int count, StackT& to) {
+		assert(count > 0 && count <= size());
+		const int height = size() - count;
+		const uint64_t below = colors() & ((1ull << height) - 1);
+		to.bits = pack(to.colors() | (colors() >> height) << to.size(), to.size() + count, top());
+		bits = pack(below, height, flatTop(below, height));
+	}
+
+	int8_t size() const {
+		return (int8_t)(bits >> HEIGHT_SHIFT);
+	}
+
+	// true if the piece at the index from the bottom is white
+	inline bool isWhite(int index) const {
+		return (bits >> index) & 1;
+	}
+
+	inline std::bitset<CAPACITY> stack() const {
+		return std::bitset<CAPACITY>(colors());
+	}
+
+	bool operator == (const StackT& other) const {
+		return bits == other.bits;
+	}
+
+	bool operator != (const StackT& other) const { return !(*this == other);}
+
+	inline int piecesOfColor(int color) const {
+		const int white = __builtin_popcountll(colors());
+		return color > 0 ? white : size() - white;
+	}
+};
+
+template<int CAPACITY>
+class StackT<CAPACITY, false> {
+private:
+	const static int WORDS = (CAPACITY + 63) / 64;
+
+	uint64_t words[WORDS] = {};
 	int8_t stack_height = 0;
-	std::bitset<48> _stack = 0;
+	int8_t piece_top = 0;
+
+	// count bits starting at the index, count is at most 64
+	inline uint64_t extract(int index, int count) const {
+		const int word = index / 64;
+		const int shift = index % 64;
+		uint64_t result = word < WORDS ? words[word] >> shift : 0;
+		if (shift != 0 && word + 1 < WORDS) result |= words[word + 1] << (64 - shift);
+		return count >= 64 ? result : result & ((1ull << count) - 1);
+	}
+
+	// ors the value in at the index, the bits there must be clear
+	inline void insert(int index, uint64_t value) {
+		const int word = index / 64;
+		const int shift = index % 64;
+		words[word] |= value << shift;
+		if (shift != 0 && word + 1 < WORDS) words[word + 1] |= value >> (64 - shift);
+	}
+
+	// clears every bit from the index up
+	inline void truncate(int index) {
+		const int word = index / 64;
+		if (word >= WORDS) return ;
+		words[word] &= (1ull << (index % 64)) - 1;
+		for (int i = word + 1; i < WORDS; ++i) words[i] = 0;
+	}
+
+	inline int8_t flatTop() const {
+		if (stack_height == 0) return 0;
+		return isWhite(stack_height - 1) ? PIECE_FLAT : -PIECE_FLAT;
+	}
 public:
 	void push(int8_t piece) {
-		_stack[stack_height] = piece > 0 ? 1 : 0;
+		insert(stack_height, piece > 0);
 		piece_top = piece;
-
 		stack_height++;
 	}
 
@@ -44,29 +169,56 @@ public:
 	inline void pop() {
 		assert(stack_height > 0);
 		stack_height--;
-		_stack[stack_height] = 0;
-		piece_top = stack_height == 0 ? 0 : ((_stack[stack_height - 1] > 0) ? PIECE_FLAT : -PIECE_FLAT);
+		truncate(stack_height);
+		piece_top = flatTop();
+	}
+
+	// moves the top count pieces onto the other stack in the same order
+	inline void moveTop(int count, StackT& to) {
+		assert(count > 0 && count <= stack_height && count <= 64);
+		const int height = stack_height - count;
+		to.insert(to.stack_height, extract(height, count));
+		to.stack_height += count;
+		to.piece_top = piece_top;
+		truncate(height);
+		stack_height = height;
+		piece_top = flatTop();
 	}
 
 	int8_t size() const {
 		return stack_height;
 	}
 
-	inline const std::bitset<48>& stack() const {
-		return _stack;
+	// true if the piece at the index from the bottom is white
+	inline bool isWhite(int index) const {
+		return (words[index / 64] >> (index % 64)) & 1;
 	}
 
-	bool operator == (const Stack& other) const {
-		return piece_top == other.piece_top && _stack == other._stack;
+	inline std::bitset<CAPACITY> stack() const {
+		std::bitset<CAPACITY> result;
+		for (int i = WORDS - 1; i >= 0; --i) {
+			result <<= 64;
+			result |= std::bitset<CAPACITY>(words[i]);
+		}
+		return result;
 	}
 
-	bool operator != (const Stack& other) const { return !(*this == other);}
+	bool operator == (const StackT& other) const {
+		return stack_height == other.stack_height && piece_top == other.piece_top
+			&& memcmp(words, other.words, sizeof(words)) == 0;
+	}
+
+	bool operator != (const StackT& other) const { return !(*this == other);}
 
 	inline int piecesOfColor(int color) const {
-		return color > 0 ? stack().count() : stack_height - stack().count();
+		int white = 0;
+		for (int i = 0; i < WORDS; ++i) white += __builtin_popcountll(words[i]);
+		return color > 0 ? white : stack_height - white;
 	}
 };
 
+typedef StackT<BoardSize<5>::STACK_CAPACITY> Stack;
+
 class Move {
 public:
 	uint32_t moveid;
@@ -75,8 +227,9 @@ public:
 	Move() : moveid(0), board_hash(0) { };
 	Move(uint64_t board_hash, uint32_t moveid) : moveid(moveid), board_hash(board_hash) { };
 
-	void apply(Board& board) const;
-	void revert(Board& board) const;
+	// NOTE: moveids index the move tables for the size of the board they were generated on
+	template<int N> void apply(BoardT<N>& board) const;
+	template<int N> void revert(BoardT<N>& board) const;
 
 	size_t hash() const {
 		size_t hash = std::hash<uint32_t>()(moveid);
@@ -90,16 +243,25 @@ public:
 		return moveid == other.moveid && board_hash == other.board_hash;
 	}
 
-	std::string toString() const;
+	// describes the move as a move on a board of the size, 5x5 unless given another
+	template<int N = 5> std::string toString() const;
 };
 
-class Board {
+/**
+	an N by N board, Board is the standard 5x5 one. the members are defined in board.cpp and movegen.cpp and
+	instantiated there for every supported size
+*/
+template<int N>
+class BoardT {
 public:
-	// TODO: enable support for multiple board sizes... ergh.
-	const static int SIZE = 5;
-	const static int SQUARES = 25;
+	const static int SIZE = N;
+	const static int SQUARES = N * N;
 
-	const static int PIECES_PER_SIDE = 21;
+	const static int PIECES_PER_SIDE = BoardSize<N>::PIECES;
+	const static int CAPSTONES_PER_SIDE = BoardSize<N>::CAPSTONES;
+	const static int STACK_CAPACITY = BoardSize<N>::STACK_CAPACITY;
+
+	typedef StackT<STACK_CAPACITY> Stack;
 
 	int moveno;
 	int playerTurn;
@@ -107,18 +269,16 @@ public:
 	int piecesleft[2];
 	Stack stacks[SQUARES];
 
-	Board();
+	BoardT();
 
-	Board(const std::string& tbgEncoding);
+	// throws std::invalid_argument describing the error if the encoding is invalid
+	BoardT(const std::string& tbgEncoding);
 
 	void move(int8_t fr, int8_t to, int8_t count) {
-		assert(fr >= 0 && fr < Board::SQUARES && to >= 0 && to < Board::SQUARES);
+		assert(fr >= 0 && fr < SQUARES && to >= 0 && to < SQUARES);
 
 		if (count == 0) return ;
-		int8_t temp = stacks[fr].top();
-		stacks[fr].pop();
-		move(fr, to, count - 1);
-		stacks[to].push(temp);
+		stacks[fr].moveTop(count, stacks[to]);
 	}
 
 	void place(int8_t pos, int8_t piece) {
@@ -130,7 +290,7 @@ public:
 	}
 
 	uint64_t hash() const {
-		return murmurhash(this, sizeof(Board), 0);
+		return murmurhash(this, sizeof(BoardT), 0);
 	}
 
 	std::vector<Move> get_moves() const {
@@ -139,6 +299,16 @@ public:
 
 	std::vector<Move> get_moves(int8_t team) const;
 
+	// the number of moves get_moves would return, without building them
+	int count_moves() const {
+		return count_moves(playerTurn);
+	}
+
+	int count_moves(int8_t team) const;
+
+	// the number of spreads the stacks of the team can make
+	int count_spreads(int8_t team) const;
+
 	bool isLateGame() const {
 		return piecesleft[0] < 5 || piecesleft[1] < 5;
 	}
@@ -146,18 +316,50 @@ public:
 	// the least cost distance from one side to the other...
 	int getDjikstraScore(int player, int *horDistance = nullptr, int *vertDistance = nullptr) const;
 
+	// squares whose top piece counts towards a road for the player, bit i is stacks[i]
+	uint64_t roadBits(int player) const;
+
+	// true if the player has a road connecting two opposite edges
+	bool hasRoad(int player) const;
+
+	// empty squares where a flat placed by the player would complete a road
+	uint64_t roadThreats(int player) const;
+
+	// white tops minus black tops, how the game is scored once a reserve runs out
+	int flatDifference() const;
+
 	int getWinner() const; // returns -1 or +1 for winner otherwise 0
 
+	enum TBGError {
+		TBG_OK = 0,
+		TBG_BAD_NUMBER,
+		TBG_BAD_TURN,
+		TBG_BAD_SIZE,
+		TBG_BAD_STACK,
+		TBG_BAD_SQUARE_COUNT,
+	};
+
+	// enough room for the encoding of any board the parser accepts
+	const static int TBG_MAX_LENGTH = 64 + SQUARES * (STACK_CAPACITY + 2);
+
+	// single pass parser, leaves the board untouched on error
+	static TBGError parseTBG(const char* str, size_t length, BoardT* board);
+	static const char* tbgErrorString(TBGError error);
+
+	// writes the nul terminated encoding into the buffer, truncating it if it does not fit. returns the length of
+	// the full encoding like snprintf does
+	size_t writeTBG(char* buffer, size_t size) const;
+
 	std::string toTBGEncoding() const;
 
-	bool operator == (const Board& other) {
-		return memcmp(this, &other, sizeof(Board)) == 0;
+	bool operator == (const BoardT& other) {
+		return memcmp(this, &other, sizeof(BoardT)) == 0;
 	};
 
-	bool operator != (const Board& other) { return !(*this == other); }
+	bool operator != (const BoardT& other) { return !(*this == other); }
 
-	Board& operator=(const Board& other) {
-		std::memcpy(this, &other, sizeof(Board));
+	BoardT& operator=(const BoardT& other) {
+		std::memcpy(this, &other, sizeof(BoardT));
 		return *this;
 	}
 
@@ -170,10 +372,11 @@ public:
 	}
 };
 
-std::ostream& operator << (std::ostream& out, const Board& board);
+template<int N>
+std::ostream& operator << (std::ostream& out, const BoardT<N>& board);
 
-constexpr int INDEX_BOARD(int x, int y) {
-	return Board::SIZE * y + x;
+constexpr int INDEX_BOARD(int x, int y, int size = Board::SIZE) {
+	return size * y + x;
 }
 
 #endif
@@ -0,0 +1,129 @@
+#include <algorithm>
+
+#include "book.h"
+#include "helpers.h"
+#include "movegen.h"
+#include "symmetry.h"
+
+namespace book {
+	void Builder::addGame(const Board& start, const uint32_t* moveids, int plies, int result, int maxPlies) {
+		Board board = start;
+		for (int i = 0; i < plies && i < maxPlies; ++i) {
+			if (moveids[i] >= movegen::all_moves.size()) return;
+
+			Key key = {board.hash(), moveids[i]};
+			if (_canonical) {
+				int sym;
+				key.hash = symmetry::canonicalHash(board, &sym);
+				key.moveid = symmetry::transformMove(sym, moveids[i]);
+			}
+			Stats& stats = _entries[key];
+			stats.games++;
+			stats.points += result == 0 ? 0.5f : (result == board.playerTurn ? 1.0f : 0.0f);
+
+			movegen::all_moves[moveids[i]].apply(board);
+		}
+	}
+
+	bool Builder::write(const std::string& path, int minGames) const {
+		std::vector<Entry> entries;
+		for (const auto& it : _entries) {
+			if (it.second.games < (uint32_t) minGames) continue;
+			Entry entry;
+			bzero(&entry, sizeof(entry));
+			entry.hash = it.first.hash;
+			entry.moveid = it.first.moveid;
+			entry.games = it.second.games;
+			entry.points = it.second.points;
+			entries.push_back(entry);
+		}
+		std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+			if (a.hash != b.hash) return a.hash < b.hash;
+			return a.games > b.games;
+		});
+
+		FILE *file = fopen(path.c_str(), "wb");
+		if (!file) return false;
+		record::FileHeader header = {_canonical ? CANONICAL_BOOK_MAGIC : BOOK_MAGIC, record::VERSION};
+		bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+		if (ok && !entries.empty())
+			ok = fwrite(entries.data(), sizeof(Entry), entries.size(), file) == entries.size();
+		return fclose(file) == 0 && ok;
+	}
+
+	bool Book::open(const std::string& path) {
+		_canonical = false;
+		if (_file.open(path, BOOK_MAGIC)) return true;
+		_canonical = true;
+		return _file.open(path, CANONICAL_BOOK_MAGIC);
+	}
+
+	const Entry* Book::find(uint64_t hash, size_t* count) const {
+		const Entry* begin = (const Entry*) _file.data();
+		const Entry* end = begin + size();
+		const Entry* first = std::lower_bound(begin, end, hash, [](const Entry& entry, uint64_t hash) {
+			return entry.hash < hash;
+		});
+
+		const Entry* last = first;
+		while (last != end && last->hash == hash) last++;
+		*count = last - first;
+		return first;
+	}
+
+	bool Book::probe(const Board& board, uint32_t* moveid, int minGames) const {
+		int sym = 0;
+		const uint64_t hash = _canonical ? symmetry::canonicalHash(board, &sym) : board.hash();
+		size_t count;
+		const Entry* entries = find(hash, &count);
+
+		const Entry* best = nullptr;
+		std::vector<Move> moves;
+		for (size_t i = 0; i < count; ++i) {
+			const Entry& entry = entries[i];
+			if (entry.games < (uint32_t) minGames) continue;
+			if (best && entry.score() <= best->score()) continue;
+
+			// NOTE: guards against hash collisions and books built for another move table
+			if (moves.empty()) moves = board.get_moves();
+			const uint32_t candidate = _canonical ? symmetry::transformMove(symmetry::inverse(sym), entry.moveid) : entry.moveid;
+			bool legal = false;
+			for (const Move& move : moves) legal |= move.moveid == candidate;
+			if (legal) best = &entry;
+		}
+
+		if (!best) return false;
+		*moveid = _canonical ? symmetry::transformMove(symmetry::inverse(sym), best->moveid) : best->moveid;
+		return true;
+	}
+
+	bool openingPlacement(const Board& board, uint32_t* moveid) {
+		const int corners[4] = {
+			INDEX_BOARD(0, 0), INDEX_BOARD(Board::SIZE - 1, 0),
+			INDEX_BOARD(Board::SIZE - 1, Board::SIZE - 1), INDEX_BOARD(0, Board::SIZE - 1)
+		};
+
+		if (board.moveno == 0) {
+			*moveid = movegen::placements[corners[fast_rand_range(4)]][0].moveid;
+			return true;
+		}
+		if (board.moveno != 1) return false;
+
+		// NOTE: corners are listed going around the board so i + 1 and i + 3 are adjacent, i + 2 is opposite
+		int taken = -1;
+		for (int i = 0; i < 4; ++i) {
+			if (board.stacks[corners[i]].size() > 0) taken = i;
+		}
+
+		int corner;
+		if (taken < 0) {
+			corner = fast_rand_range(4);
+		} else {
+			// NOTE: a quarter of the time the opposite corner, otherwise either adjacent one
+			const uint32_t r = fast_rand_range(8);
+			corner = (taken + (r < 2 ? 2 : (r < 5 ? 1 : 3))) % 4;
+		}
+		*moveid = movegen::placements[corners[corner]][0].moveid;
+		return true;
+	}
+}
@@ -0,0 +1,96 @@
+#ifndef __BOOK_H_
+#define __BOOK_H_
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "board.h"
+#include "record.h"
+
+/**
+	opening book. the builder aggregates how every move played in a position scored over a set of games, keyed by
+	position hash, and writes the entries sorted by hash. the engine maps the file and binary searches it, so opening
+	a book costs nothing and a hit costs a few page touches.
+*/
+
+namespace book {
+	const uint32_t BOOK_MAGIC = 0x42414b54; // "TAKB"
+	// books keyed by canonical hash, with moves stored in the canonical orientation
+	const uint32_t CANONICAL_BOOK_MAGIC = 0x53414b54; // "TAKS"
+
+	// by default only the first plies of each game go into the book
+	const int DEFAULT_PLIES = 12;
+
+	// moves seen in fewer games than this are ignored when building and probing
+	const int DEFAULT_MIN_GAMES = 4;
+
+	struct Entry {
+		uint64_t hash;
+		uint16_t moveid;
+		uint16_t reserved;
+		uint32_t games;
+		float points; // 1 per win and 0.5 per draw for the side making the move
+		uint32_t reserved2;
+
+		float score() const { return (points + 1) / (games + 2); }
+	};
+	static_assert(sizeof(Entry) == 24, "book entries should stay 24 bytes");
+
+	class Builder {
+	public:
+		// a canonical book shares statistics between rotated and mirrored positions
+		Builder(bool canonical = false) : _canonical(canonical) { };
+
+		// result is +1 if white won, -1 if black won and 0 otherwise
+		void addGame(const Board& start, const uint32_t* moveids, int plies, int result, int maxPlies = DEFAULT_PLIES);
+
+		size_t size() const { return _entries.size(); }
+		bool write(const std::string& path, int minGames = DEFAULT_MIN_GAMES) const;
+
+	private:
+		struct Key {
+			uint64_t hash;
+			uint32_t moveid;
+			bool operator == (const Key& other) const { return hash == other.hash && moveid == other.moveid; }
+		};
+		struct KeyHash {
+			size_t operator()(const Key& key) const { return key.hash ^ (key.moveid * 0x9e3779b97f4a7c15ull); }
+		};
+		struct Stats {
+			uint32_t games = 0;
+			float points = 0;
+		};
+		std::unordered_map<Key, Stats, KeyHash> _entries;
+		bool _canonical;
+	};
+
+	class Book {
+	public:
+		bool open(const std::string& path);
+
+		size_t size() const { return _file.size() / sizeof(Entry); }
+
+		// all entries for the position, count is 0 if it is not in the book
+		const Entry* find(uint64_t hash, size_t* count) const;
+
+		// the best scoring legal book move with at least minGames games behind it
+		bool probe(const Board& board, uint32_t* moveid, int minGames = DEFAULT_MIN_GAMES) const;
+
+		bool isCanonical() const { return _canonical; }
+
+	private:
+		record::MappedFile _file;
+		bool _canonical = false;
+	};
+
+	/**
+		the first two plies place the opponent's stone. put it in a corner, where it is least useful to them. on the
+		second ply prefer a corner next to the one we were given, but mix in the opposite corner to keep opponents
+		on their toes. returns false once past the placement plies.
+	*/
+	bool openingPlacement(const Board& board, uint32_t* moveid);
+}
+
+#endif
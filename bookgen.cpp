@@ -0,0 +1,86 @@
+#include <unistd.h>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "book.h"
+#include "ptn.h"
+#include "record.h"
+
+/**
+	builds an opening book out of binary game records (see record.h) and PTN files
+*/
+
+static void usage(const char *name) {
+	std::cerr << "usage: " << name << " [options] -o BOOK <games>...\n"
+		"\tgames are binary game records or PTN files\n"
+		"\t-p PLIES    plies of every game that go into the book (default " << book::DEFAULT_PLIES << ")\n"
+		"\t-g GAMES    drop moves played in fewer games than this (default " << book::DEFAULT_MIN_GAMES << ")\n"
+		"\t-s          share statistics between rotated and mirrored positions\n";
+}
+
+int main(int argc, char **argv) {
+	std::string output;
+	int plies = book::DEFAULT_PLIES;
+	int minGames = book::DEFAULT_MIN_GAMES;
+	bool canonical = false;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "o:p:g:s")) != -1) {
+		switch (opt) {
+			case 'o': output = optarg; break;
+			case 'p': plies = atoi(optarg); break;
+			case 'g': minGames = atoi(optarg); break;
+			case 's': canonical = true; break;
+			default: usage(argv[0]); return 1;
+		}
+	}
+	if (output.empty() || optind == argc) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	book::Builder builder(canonical);
+	for (int i = optind; i < argc; ++i) {
+		int games = 0;
+		int skipped = 0;
+
+		record::GameReader records;
+		if (records.open(argv[i])) {
+			record::Game game;
+			std::vector<uint32_t> moveids;
+			while (records.next(&game)) {
+				moveids.assign(game.moveids, game.moveids + game.plies);
+				builder.addGame(Board(), moveids.data(), moveids.size(), game.result, plies);
+				games++;
+			}
+		} else {
+			std::ifstream in(argv[i]);
+			if (!in) {
+				std::cerr << "failed to open " << argv[i] << std::endl;
+				return 1;
+			}
+			ptn::Reader reader(in);
+			ptn::Game game;
+			while (reader.next(&game)) {
+				// NOTE: a broken game still tells us about the moves before the problem, but not who won
+				if (!game.error.empty()) {
+					skipped++;
+					continue;
+				}
+				builder.addGame(game.start, game.moveids.data(), game.moveids.size(), game.result, plies);
+				games++;
+			}
+		}
+		std::cout << argv[i] << ": " << games << " games";
+		if (skipped) std::cout << ", " << skipped << " skipped";
+		std::cout << std::endl;
+	}
+
+	if (!builder.write(output, minGames)) {
+		std::cerr << "failed to write " << output << std::endl;
+		return 1;
+	}
+	std::cout << builder.size() << " position/move pairs seen, written to " << output << std::endl;
+	return 0;
+}
@@ -0,0 +1,118 @@
+#include <algorithm>
+
+#include "endgame.h"
+
+namespace endgame {
+	// scores this far from WIN are decided games
+	const int DECIDED = WIN - 100000;
+
+	static inline bool decided(int score) {
+		return score >= DECIDED || score <= -DECIDED;
+	}
+
+	bool applies(const Board& board, int threshold) {
+		return board.piecesleft[0] <= threshold || board.piecesleft[1] <= threshold;
+	}
+
+	Solver::Solver(int tableBits) : _table((size_t)1 << tableBits), _mask(((uint64_t)1 << tableBits) - 1) { }
+
+	Result Solver::solve(const Board& board, unsigned long maxNodes) {
+		Board copy = board;
+		Result result;
+		_nodes = 0;
+		_maxNodes = maxNodes;
+		_aborted = false;
+
+		for (int depth = 1; depth <= MAX_DEPTH; ++depth) {
+			Move best;
+			const int score = search(copy, depth, -WIN, WIN, &best);
+			// NOTE: an unfinished iteration may not have looked at the best move yet
+			if (_aborted) break;
+
+			result.move = best;
+			result.score = score;
+			result.depth = depth;
+			result.exact = decided(score);
+			if (result.exact) break;
+		}
+		return result;
+	}
+
+	void Solver::orderMoves(Board& board, uint32_t first, std::vector<Move>* moves) const {
+		const int team = board.playerTurn;
+		const int before = board.flatDifference() * team;
+
+		std::vector<std::pair<int, Move>> scored;
+		scored.reserve(moves->size());
+		for (const Move& move : *moves) {
+			move.apply(board);
+			int swing = board.flatDifference() * team - before;
+			if (board.getWinner() == team) swing += WIN;
+			move.revert(board);
+			if (move.moveid == first) swing = WIN * 2;
+			scored.push_back(std::make_pair(swing, move));
+		}
+
+		std::stable_sort(scored.begin(), scored.end(), [](const std::pair<int, Move>& a, const std::pair<int, Move>& b) {
+			return a.first > b.first;
+		});
+		for (size_t i = 0; i < scored.size(); ++i)
+			(*moves)[i] = scored[i].second;
+	}
+
+	int Solver::search(Board& board, int depth, int alpha, int beta, Move* best) {
+		_nodes++;
+
+		const int winner = board.getWinner();
+		if (winner != 0) return winner == board.playerTurn ? WIN - board.moveno : board.moveno - WIN;
+		if (depth == 0) return board.flatDifference() * board.playerTurn;
+		if (_nodes >= _maxNodes) {
+			_aborted = true;
+			return 0;
+		}
+
+		const uint64_t hash = board.hash();
+		Entry& entry = _table[hash & _mask];
+		uint32_t first = UINT32_MAX;
+		if (entry.hash == hash && entry.bound != NONE) {
+			first = entry.moveid;
+			// NOTE: the root always searches so it has a move to hand back
+			if (!best && entry.depth >= depth) {
+				if (entry.bound == EXACT) return entry.score;
+				if (entry.bound == LOWER && entry.score >= beta) return entry.score;
+				if (entry.bound == UPPER && entry.score <= alpha) return entry.score;
+			}
+		}
+
+		std::vector<Move> moves = board.get_moves();
+		if (moves.empty()) return 0;
+		orderMoves(board, first, &moves);
+
+		const int originalAlpha = alpha;
+		int bestScore = -WIN;
+		uint32_t bestMove = moves[0].moveid;
+		for (const Move& move : moves) {
+			move.apply(board);
+			const int score = -search(board, depth - 1, -beta, -alpha, nullptr);
+			move.revert(board);
+			if (_aborted) return 0;
+
+			if (score > bestScore) {
+				bestScore = score;
+				bestMove = move.moveid;
+				if (best) *best = move;
+			}
+			if (score > alpha) alpha = score;
+			if (alpha >= beta) break;
+		}
+
+		// NOTE: the entry may have been taken over by a position further down, always replace it
+		Entry& slot = _table[hash & _mask];
+		slot.hash = hash;
+		slot.score = bestScore;
+		slot.moveid = bestMove;
+		slot.depth = depth;
+		slot.bound = bestScore <= originalAlpha ? UPPER : (bestScore >= beta ? LOWER : EXACT);
+		return bestScore;
+	}
+}
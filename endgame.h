@@ -0,0 +1,77 @@
+#ifndef __ENDGAME_H_
+#define __ENDGAME_H_
+
+#include <stdint.h>
+#include <vector>
+
+#include "board.h"
+
+/**
+	exact solver for the end of the game, when a reserve is nearly empty and the game is about to be decided on flats.
+	an iteratively deepened alpha-beta search scores the end of the game by getWinner and the horizon by the flat
+	difference, with its own hash table and moves ordered by how much they swing the flat count. it stops as soon
+	as one iteration proves the result, or when the node budget runs out.
+*/
+
+namespace endgame {
+	// the solver is used once a side has this many pieces or fewer left to place. with more than that the side that
+	// is behind can keep spreading instead of placing, and few positions are proven within the budget
+	const int DEFAULT_RESERVE_THRESHOLD = 2;
+	const unsigned long DEFAULT_NODES = 500000;
+	const int DEFAULT_TABLE_BITS = 20;
+
+	// a won game scores WIN minus the move number it is won on, so faster wins score higher
+	const int WIN = 1000000;
+	const int MAX_DEPTH = 64;
+
+	// a side has at most threshold pieces left to place
+	bool applies(const Board& board, int threshold = DEFAULT_RESERVE_THRESHOLD);
+
+	struct Result {
+		Move move;
+		int score = 0; // for the side to move
+		int depth = 0; // of the last finished iteration
+		bool exact = false; // the score is a proven win or loss
+
+		bool win() const { return exact && score > 0; }
+	};
+
+	class Solver {
+	public:
+		// the table holds 2^tableBits positions
+		Solver(int tableBits = DEFAULT_TABLE_BITS);
+
+		Result solve(const Board& board, unsigned long maxNodes = DEFAULT_NODES);
+
+		// positions searched by the last solve
+		unsigned long nodes() const { return _nodes; }
+
+	private:
+		enum Bound : uint8_t {
+			NONE = 0,
+			EXACT,
+			LOWER,
+			UPPER,
+		};
+
+		struct Entry {
+			uint64_t hash;
+			int32_t score;
+			uint32_t moveid;
+			int8_t depth;
+			Bound bound;
+		};
+
+		std::vector<Entry> _table;
+		uint64_t _mask;
+
+		unsigned long _nodes = 0;
+		unsigned long _maxNodes = 0;
+		bool _aborted = false;
+
+		int search(Board& board, int depth, int alpha, int beta, Move* best);
+		void orderMoves(Board& board, uint32_t first, std::vector<Move>* moves) const;
+	};
+}
+
+#endif
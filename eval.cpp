@@ -0,0 +1,239 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include "eval.h"
+
+namespace eval {
+	const char* const WEIGHT_NAMES[WEIGHT_COUNT] = {
+		"piece",
+		"stack",
+		"stack_own",
+		"neighbor",
+		"neighbor_factor",
+		"hard_cap",
+		"center",
+		"road",
+	};
+
+	const double DEFAULT_WEIGHTS[WEIGHT_COUNT] = {
+		1.0, // PIECE
+		0.3, // STACK
+		1.3, // STACK_OWN
+		0.2, // NEIGHBOR
+		2.0, // NEIGHBOR_FACTOR
+		2.0, // HARD_CAP
+		0.075, // CENTER
+		4.0, // ROAD
+	};
+
+	double weights[WEIGHT_COUNT] = {
+		DEFAULT_WEIGHTS[PIECE],
+		DEFAULT_WEIGHTS[STACK],
+		DEFAULT_WEIGHTS[STACK_OWN],
+		DEFAULT_WEIGHTS[NEIGHBOR],
+		DEFAULT_WEIGHTS[NEIGHBOR_FACTOR],
+		DEFAULT_WEIGHTS[HARD_CAP],
+		DEFAULT_WEIGHTS[CENTER],
+		DEFAULT_WEIGHTS[ROAD],
+	};
+
+	bool loadWeights(const std::string& path, double* into) {
+		std::ifstream in(path);
+		if (!in) return false;
+
+		double loaded[WEIGHT_COUNT];
+		std::copy(into, into + WEIGHT_COUNT, loaded);
+		std::string line;
+		while (std::getline(in, line)) {
+			std::istringstream fields(line);
+			std::string name;
+			double value;
+			if (!(fields >> name) || name[0] == '#') continue;
+			const char* const* found = std::find(WEIGHT_NAMES, WEIGHT_NAMES + WEIGHT_COUNT, name);
+			if (found == WEIGHT_NAMES + WEIGHT_COUNT || !(fields >> value)) return false;
+			loaded[found - WEIGHT_NAMES] = value;
+		}
+		std::copy(loaded, loaded + WEIGHT_COUNT, into);
+		return true;
+	}
+
+	bool writeWeights(const std::string& path, const double* from) {
+		std::ofstream out(path);
+		if (!out) return false;
+		out << std::setprecision(17);
+		for (int i = 0; i < WEIGHT_COUNT; ++i)
+			out << WEIGHT_NAMES[i] << " " << from[i] << "\n";
+		out.close();
+		return !out.fail();
+	}
+
+	// how far each side is from a road, white's distance taken from black's
+	template<int N>
+	static int roadDistance(const BoardT<N>& board) {
+		int horDjkWhite;
+		int vrtDjkWhite;
+		int horDjkBlack;
+		int vrtDjkBlack;
+
+		board.getDjikstraScore(1, &horDjkWhite, &vrtDjkWhite);
+		board.getDjikstraScore(-1, &vrtDjkBlack, &horDjkBlack);
+
+		horDjkWhite = N - horDjkWhite;
+		horDjkBlack = N - horDjkBlack;
+		vrtDjkWhite = N - vrtDjkWhite;
+		vrtDjkBlack = N - vrtDjkBlack;
+
+		return horDjkWhite - horDjkBlack + vrtDjkWhite - vrtDjkBlack;
+	}
+
+	// what the stack under a top counts, before any weight is applied
+	struct StackTerms {
+		int own;
+		int other;
+		int neighbors;
+		bool hardCap;
+		int center;
+	};
+
+	template<int N>
+	static StackTerms stackTerms(const BoardT<N>& board, int x, int y) {
+		const typename BoardT<N>::Stack& st = board.stacks[x + y * N];
+		const int8_t top = st.top();
+		StackTerms terms;
+
+		// value for the stack count and range and all that jazzzyness.
+		const std::bitset<BoardT<N>::STACK_CAPACITY> whitePieces = st.stack();
+		const std::bitset<BoardT<N>::STACK_CAPACITY> blackPieces = ~whitePieces;
+
+		int numWhitePieces = whitePieces.count() - (whitePieces >> N).count();
+		int numBlackPieces = blackPieces.count() - (blackPieces >> N).count();
+		terms.own = top > 0 ? numWhitePieces : numBlackPieces;
+		terms.other = top > 0 ? numBlackPieces : numWhitePieces;
+
+		// neighbors of the same color
+		terms.neighbors = 0;
+		if (x > 0 && board.stacks[x - 1 + y * N].top() * top > 0) terms.neighbors++;
+		if (y > 0 && board.stacks[x + (y - 1) * N].top() * top > 0) terms.neighbors++;
+		if (y > 0 && x > 0 && board.stacks[x - 1 + (y - 1) * N].top() * top > 0) terms.neighbors++;
+
+		// a hard cap if possible!
+		// NOTE: a lone capstone has nothing under it, reading below it is only harmless on single word bitsets
+		terms.hardCap = false;
+		if (top == PIECE_CAP && st.size() > 1) terms.hardCap = whitePieces[st.size() - 2] == 1;
+		else if (top == -PIECE_CAP && st.size() > 1) terms.hardCap = blackPieces[st.size() - 2] == 1;
+
+		terms.center = abs(x - (N - 1) / 2) + abs(y - (N - 1) / 2);
+		return terms;
+	}
+
+	template<int N>
+	double scoreBoard(const BoardT<N>& board, const double* w) {
+		double mat = scoreMaterial(board, w);
+		double djk = roadDistance(board);
+		return djk * w[ROAD] + mat;
+	}
+
+	template<int N>
+	double scoreMaterial(const BoardT<N>& board, const double* w) {
+		double score = 0;
+
+		for (int y = 0; y < N; ++y) {
+			for (int x = 0; x < N; ++x) {
+				int8_t top = board.stacks[x + y * N].top();
+				if (top == 0) continue;
+
+				const StackTerms stack = stackTerms(board, x, y);
+				double stratValue = 0;
+				stratValue += (stack.own * w[STACK_OWN] - stack.other) * w[STACK];
+
+				// buff for having neighbors of the same color
+				if (stack.neighbors > 0) {
+					double castleBuff = 1.0;
+					for (int i = 0; i < stack.neighbors; ++i)
+						castleBuff *= w[NEIGHBOR_FACTOR];
+					stratValue += castleBuff * w[NEIGHBOR];
+				}
+
+				if (stack.hardCap)
+					stratValue += w[HARD_CAP];
+
+				// placement value
+				stratValue -= stack.center * w[CENTER];
+
+				if (top > 0)
+					score += stratValue + w[PIECE];
+				else
+					score -= stratValue + w[PIECE];
+			}
+		}
+
+		return score;
+	}
+
+	template<int N>
+	Terms terms(const BoardT<N>& board) {
+		Terms result;
+		bzero(&result, sizeof(result));
+		for (int y = 0; y < N; ++y) {
+			for (int x = 0; x < N; ++x) {
+				const int8_t top = board.stacks[x + y * N].top();
+				if (top == 0) continue;
+
+				const int sign = top > 0 ? 1 : -1;
+				const StackTerms stack = stackTerms(board, x, y);
+				result.pieces += sign;
+				result.own += sign * stack.own;
+				result.other += sign * stack.other;
+				if (stack.neighbors > 0) result.neighbors[stack.neighbors - 1] += sign;
+				result.hardCaps += sign * stack.hardCap;
+				result.center += sign * stack.center;
+			}
+		}
+		result.road = roadDistance(board);
+		return result;
+	}
+
+	double score(const Terms& terms, const double* w) {
+		const double factor = w[NEIGHBOR_FACTOR];
+		const double neighbors = terms.neighbors[0] * factor + terms.neighbors[1] * factor * factor
+			+ terms.neighbors[2] * factor * factor * factor;
+		return terms.road * w[ROAD] + terms.pieces * w[PIECE] + (terms.own * w[STACK_OWN] - terms.other) * w[STACK]
+			+ neighbors * w[NEIGHBOR] + terms.hardCaps * w[HARD_CAP] - terms.center * w[CENTER];
+	}
+
+	void gradient(const Terms& terms, const double* w, double* gradient) {
+		const double factor = w[NEIGHBOR_FACTOR];
+		gradient[PIECE] = terms.pieces;
+		gradient[STACK] = terms.own * w[STACK_OWN] - terms.other;
+		gradient[STACK_OWN] = terms.own * w[STACK];
+		gradient[NEIGHBOR] = terms.neighbors[0] * factor + terms.neighbors[1] * factor * factor
+			+ terms.neighbors[2] * factor * factor * factor;
+		gradient[NEIGHBOR_FACTOR] = w[NEIGHBOR] * (terms.neighbors[0] + 2 * terms.neighbors[1] * factor
+			+ 3 * terms.neighbors[2] * factor * factor);
+		gradient[HARD_CAP] = terms.hardCaps;
+		gradient[CENTER] = -terms.center;
+		gradient[ROAD] = terms.road;
+	}
+
+	template<int N>
+	double winProbability(const BoardT<N>& board, double scale) {
+		return 1.0 / (1.0 + std::exp(-scoreBoard(board) / scale));
+	}
+
+#define INSTANTIATE_EVAL(N) \
+	template double scoreBoard<N>(const BoardT<N>& board, const double* w); \
+	template double scoreMaterial<N>(const BoardT<N>& board, const double* w); \
+	template double winProbability<N>(const BoardT<N>& board, double scale); \
+	template Terms terms<N>(const BoardT<N>& board);
+
+	INSTANTIATE_EVAL(3)
+	INSTANTIATE_EVAL(4)
+	INSTANTIATE_EVAL(5)
+	INSTANTIATE_EVAL(6)
+	INSTANTIATE_EVAL(7)
+	INSTANTIATE_EVAL(8)
+}
@@ -0,0 +1,74 @@
+#ifndef __EVAL_H_
+#define __EVAL_H_
+
+#include <stdint.h>
+#include <string>
+
+#include "board.h"
+
+/**
+	static evaluation shared by the searches, positive scores are good for white.
+
+	the weights are a flat array indexed by Weight. the engine starts with the hand picked defaults and can load a
+	weights file written by the tuner at startup, a file is one "name value" pair per line.
+*/
+
+namespace eval {
+	// score difference that changes the win probability by a factor of e in odds
+	const double WIN_PROBABILITY_SCALE = 10.0;
+
+	enum Weight {
+		PIECE = 0, // per top piece
+		STACK, // per piece in the stack under a top
+		STACK_OWN, // how much more the pieces of the owner of the stack count
+		NEIGHBOR, // for a top with neighbors of the same color
+		NEIGHBOR_FACTOR, // what every neighbor multiplies the neighbor bonus by
+		HARD_CAP, // capstone on a flat of the same color
+		CENTER, // per square of distance from the center, taken off
+		ROAD, // per square a side is closer to a road
+		WEIGHT_COUNT,
+	};
+
+	extern const char* const WEIGHT_NAMES[WEIGHT_COUNT];
+	extern const double DEFAULT_WEIGHTS[WEIGHT_COUNT];
+
+	// the weights evaluations use unless they are given others
+	extern double weights[WEIGHT_COUNT];
+
+	// reads a weights file into the array, weights missing from the file keep their value. returns false and
+	// leaves the array untouched if the file cannot be read or names an unknown weight
+	bool loadWeights(const std::string& path, double* into = weights);
+	bool writeWeights(const std::string& path, const double* from = weights);
+
+	// instantiated for every supported board size in eval.cpp
+	template<int N> double scoreBoard(const BoardT<N>& board, const double* w = weights);
+	template<int N> double scoreMaterial(const BoardT<N>& board, const double* w = weights);
+
+	// logistic curve over scoreBoard, the chance that white wins from this position
+	template<int N> double winProbability(const BoardT<N>& board, double scale = WIN_PROBABILITY_SCALE);
+
+	/**
+		what scoreBoard counts on a board before any weight is applied, summed over the tops with white's positive.
+		the tuner keeps these instead of the boards, so scoring a position under new weights is a handful of
+		multiplications
+	*/
+	struct Terms {
+		int16_t pieces;
+		int16_t own; // pieces of the owner of the stack
+		int16_t other;
+		int16_t neighbors[3]; // tops with one, two and three neighbors of the same color
+		int16_t hardCaps;
+		int16_t center;
+		int16_t road;
+	};
+
+	template<int N> Terms terms(const BoardT<N>& board);
+
+	// the same score as scoreBoard on the board the terms came from
+	double score(const Terms& terms, const double* w = weights);
+
+	// the derivative of score by every weight
+	void gradient(const Terms& terms, const double* w, double* gradient);
+}
+
+#endif
@@ -2,6 +2,7 @@
 #define __HELPERS_H_
 
 #include <stdint.h>
+#include <chrono>
 
 class range {
  public:
@@ -53,5 +54,23 @@ bool squaresAreConnected(uint64_t sq1, uint64_t sq2, uint64_t path) {
 	return true;                              // Found a good path
 }
 
+// NOTE: xorshift64*, one generator per thread so playouts never contend on rand()'s lock
+inline uint64_t fast_rand() {
+	static thread_local uint64_t state = 0;
+	if (state == 0) {
+		// seed from the address of the thread local and the clock so that every thread gets its own sequence
+		state = (uint64_t)&state ^ (uint64_t)std::chrono::high_resolution_clock::now().time_since_epoch().count();
+		state = state ? state : 0x9e3779b97f4a7c15ULL;
+	}
+	state ^= state >> 12;
+	state ^= state << 25;
+	state ^= state >> 27;
+	return state * 0x2545f4914f6cdd1dULL;
+}
+
+// uniform integer in [0, n) without a division
+inline uint32_t fast_rand_range(uint32_t n) {
+	return (uint32_t)(((fast_rand() >> 32) * n) >> 32);
+}
 
 #endif
@@ -1,23 +1,181 @@
+#include <unistd.h>
+#include <chrono>
 #include <iostream>
+#include <string>
 
 #include "player.h"
 #include "board.h"
+#include "movegen.h"
+#include "ptn.h"
+#include "book.h"
+#include "eval.h"
+#include "proof.h"
+#include "tablebase.h"
 
-int main(int argc, const char **argv) {
+/**
+	engine mode, the protocol of the tournament runner: every line read is a TBG board and the answer is the board
+	after the move. boards of any size are played, the minmax search is the only player that runs on sizes other
+	than 5x5
+*/
+
+static bool engineMove(Player* player, Board* board) {
+	*board = player->makeAMove(*board);
+	return true;
+}
+
+template<int N>
+static bool engineMove(Player* player, BoardT<N>* board) {
+	MinmaxPlayer* minmax = dynamic_cast<MinmaxPlayer*>(player);
+	if (!minmax) return false;
+	*board = minmax->searchMove(*board);
+	return true;
+}
+
+template<int N>
+static void engineReply(Player* player, const std::string& line) {
+	BoardT<N> board;
+	typename BoardT<N>::TBGError error = BoardT<N>::parseTBG(line.c_str(), line.length(), &board);
+	if (error != BoardT<N>::TBG_OK) {
+		std::cout << BoardT<N>::tbgErrorString(error) << std::endl;
+	} else if (board.getWinner() != 0 || board.count_moves() == 0) {
+		std::cout << "no move to make" << std::endl;
+	} else if (!engineMove(player, &board)) {
+		std::cout << "the player only plays 5x5 boards" << std::endl;
+	} else {
+		std::cout << board.toTBGEncoding() << std::endl;
+	}
+}
+
+static int runEngine(Player* player) {
+	player->verbose = false;
+	std::string line;
+	while (std::getline(std::cin, line)) {
+		if (line.empty() || line[0] == '#') continue;
+		// NOTE: the size is the third field of the encoding
+		size_t comma = line.find(',');
+		if (comma != std::string::npos) comma = line.find(',', comma + 1);
+		switch (comma == std::string::npos ? 0 : atoi(line.c_str() + comma + 1)) {
+			case 3: engineReply<3>(player, line); break;
+			case 4: engineReply<4>(player, line); break;
+			case 5: engineReply<5>(player, line); break;
+			case 6: engineReply<6>(player, line); break;
+			case 7: engineReply<7>(player, line); break;
+			case 8: engineReply<8>(player, line); break;
+			default: std::cout << Board::tbgErrorString(Board::TBG_BAD_SIZE) << std::endl;
+		}
+	}
+	return 0;
+}
+
+int main(int argc, char **argv) {
 	// nice debug case 23,b,5,14,13,0,0;,,bF,,wF,,,wF,wF,,,,wbwbwC,,,wF,,bS,bF,,wF,bF,bF,bC,bF
 	Board board;
+	book::Book openingBook;
+	tablebase::Table table;
+	int perftDepth = 0;
+	unsigned long proofNodes = 0;
+	std::string engine;
 
-	if (argc > 1) {
+	int opt;
+	while ((opt = getopt(argc, argv, "b:e:p:s:t:w:")) != -1) {
+		switch (opt) {
+			case 'b':
+				if (!openingBook.open(optarg)) {
+					std::cerr << "failed to open book " << optarg << std::endl;
+					return 1;
+				}
+				break;
+			case 'e': engine = optarg; break;
+			case 'p': perftDepth = atoi(optarg); break;
+			case 's': proofNodes = strtoul(optarg, nullptr, 10); break;
+			case 't':
+				if (!table.open(optarg)) {
+					std::cerr << "failed to open tablebase " << optarg << std::endl;
+					return 1;
+				}
+				break;
+			case 'w':
+				if (!eval::loadWeights(optarg)) {
+					std::cerr << "failed to load weights from " << optarg << std::endl;
+					return 1;
+				}
+				break;
+			default:
+				std::cerr << "usage: " << argv[0] << " [-b BOOK] [-e ENGINE] [-p PERFT DEPTH] [-s PROOF NODES] [-t TABLEBASE] [-w WEIGHTS] [TBG or TPS board]" << std::endl;
+				return 1;
+		}
+	}
+
+	// NOTE: only the engine mode plays other sizes, the game below is on a 5x5 board
+	if (table.size() > 0 && engine.empty() && table.boardSize() != Board::SIZE) {
+		std::cerr << "the tablebase is for " << table.boardSize() << "x" << table.boardSize() << " boards" << std::endl;
+		return 1;
+	}
+
+	if (!engine.empty()) {
+		Player* player = createPlayer(engine);
+		if (!player) {
+			std::cerr << "invalid engine: " << engine << std::endl;
+			return 1;
+		}
+		if (openingBook.size() > 0) player->book = &openingBook;
+		if (table.size() > 0) player->tablebase = &table;
+		return runEngine(player);
+	}
+
+	if (optind < argc) {
+		const char *position = argv[optind];
 		std::cout << "loading board from arguments" << std::endl;
-		board = Board(argv[1]);
+		// NOTE: TPS rows are separated by slashes, TBG never contains one
+		if (strchr(position, '/')) {
+			if (!ptn::parseTPS(position, strlen(position), &board)) {
+				std::cerr << "invalid TPS" << std::endl;
+				return 1;
+			}
+		} else {
+			Board::TBGError error = Board::parseTBG(position, strlen(position), &board);
+			if (error != Board::TBG_OK) {
+				std::cerr << Board::tbgErrorString(error) << std::endl;
+				return 1;
+			}
+		}
 		std::cout << board << "\n\n---------LOADING COMPLETE. START GAME---------\n\n" << std::endl;
 	}
 
-	// TODO: if the first move place the opponent in a corner
-	// NOTE: Adjacent corner is best, but mix in opposite corner to keep them on their toes
+	if (perftDepth > 0) {
+		for (int depth = 1; depth <= perftDepth; ++depth) {
+			auto start = std::chrono::steady_clock::now();
+			uint64_t nodes = movegen::perft(board, depth);
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			std::cout << "perft " << depth << ": " << nodes << " in " << seconds << "s" << std::endl;
+		}
+		return 0;
+	}
+
+	if (proofNodes > 0) {
+		proof::Solver solver;
+		Move move;
+		auto start = std::chrono::steady_clock::now();
+		proof::Result result = solver.solve(board, proofNodes, &move);
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if (result == proof::WIN) std::cout << "win for the side to move with " << ptn::moveToString(move.moveid);
+		else if (result == proof::LOSS) std::cout << "loss for the side to move";
+		else std::cout << "unknown";
+		std::cout << " after " << solver.nodes() << " nodes in " << seconds << "s" << std::endl;
+		return 0;
+	}
 
+	// NOTE: the computer players place the opponent in a corner on the first move, see book::openingPlacement
 	Player *white = new HumanPlayer();
 	Player *black = new MinmaxPlayer(4);
+	if (openingBook.size() > 0) {
+		white->book = &openingBook;
+		black->book = &openingBook;
+	}
+	if (table.size() > 0) {
+		white->tablebase = &table;
+		black->tablebase = &table;
+	}
 
 	while (true) {
 		Player *cur = board.playerTurn == 1 ? white : black;
@@ -0,0 +1,337 @@
+#include <unistd.h>
+#include <atomic>
+#include <cstdio>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "player.h"
+#include "board.h"
+#include "movegen.h"
+#include "playout.h"
+#include "stats.h"
+#include "record.h"
+#include "book.h"
+#include "eval.h"
+#include "tablebase.h"
+
+/**
+	in-process engine-vs-engine matches, with games played concurrently on a pool of threads.
+	every opening is played twice with colors swapped so neither engine gets the better side of it. with an SPRT the
+	match stops as soon as the test decides whether A is stronger than B.
+*/
+
+struct MatchOptions {
+	std::string specs[2];
+	int games = 10;
+	int threads = 0;
+	int openingPlies = 2;
+	int maxPlies = 400;
+	bool verbose = false;
+	std::string openingsFile;
+	std::string recordFile;
+	std::string bookFile;
+	std::string tablebaseFile;
+
+	bool sprt = false;
+	double elo0 = 0;
+	double elo1 = 5;
+	double alpha = 0.05;
+	double beta = 0.05;
+};
+
+struct GameResult {
+	int winner = 0; // 0 if the first engine won, 1 if the second did, -1 for a draw
+	int plies = 0;
+	std::vector<unsigned int> moveids;
+	double thinkMs[2] = {0, 0};
+	int moves[2] = {0, 0};
+};
+
+struct MatchStats {
+	stats::Results results; // from A's point of view
+	double thinkMs[2] = {0, 0};
+	int moves[2] = {0, 0};
+	int decision = 0; // SPRT outcome, see stats::SPRT::status
+};
+
+static void usage(const char *name) {
+	std::cerr << "usage: " << name << " [options] <engine A> <engine B>\n"
+		"\tengines: human | minmax:DEPTH[:sym,mobility=F,proof=N,threats=N,endgame[=N],weights=FILE] | mcts:MS[:tt,solver,puct,sym,threats,cutoff=N,nodes=N,history=F,rave=F]\n"
+		"\t-n GAMES    number of games, rounded up to a whole number of opening pairs (default 10)\n"
+		"\t-j THREADS  games played at once (default: one per core)\n"
+		"\t-o FILE     openings as TBG encoded boards, one per line\n"
+		"\t-p PLIES    random plies per generated opening when no file is given (default 2)\n"
+		"\t-m PLIES    adjudicate the game as a draw after this many plies (default 400)\n"
+		"\t-s ELO0,ELO1[,ALPHA,BETA]\n"
+		"\t            stop as soon as an SPRT of A being ELO0 against ELO1 stronger than B decides, -n is the limit\n"
+		"\t-b BOOK     opening book for both engines\n"
+		"\t-t FILE     tablebase for both engines\n"
+		"\t-w FILE     evaluation weights for both engines, from the tuner\n"
+		"\t-r FILE     append every game to a binary game record, needs generated openings\n"
+		"\t-v          print every game result\n";
+}
+
+struct Opening {
+	Board board;
+	std::vector<unsigned int> moveids; // how the board was reached, empty if it was loaded from a file
+};
+
+static Opening randomOpening(int plies) {
+	while (true) {
+		Opening opening;
+		bool ok = true;
+		for (int i = 0; i < plies && ok; ++i) {
+			uint32_t moveid;
+			ok = playout::randomMove(opening.board, &moveid);
+			if (ok) {
+				movegen::all_moves[moveid].apply(opening.board);
+				opening.moveids.push_back(moveid);
+			}
+		}
+		if (ok && opening.board.getWinner() == 0) return opening;
+	}
+}
+
+static bool loadOpenings(const std::string& path, std::vector<Opening>* openings) {
+	std::ifstream in(path);
+	if (!in) return false;
+
+	std::string line;
+	int lineno = 0;
+	while (std::getline(in, line)) {
+		lineno++;
+		if (line.empty() || line[0] == '#') continue;
+		Opening opening;
+		Board::TBGError error = Board::parseTBG(line.c_str(), line.length(), &opening.board);
+		if (error != Board::TBG_OK) {
+			std::cerr << path << ":" << lineno << ": " << Board::tbgErrorString(error) << std::endl;
+			return false;
+		}
+		openings->push_back(opening);
+	}
+	return !openings->empty();
+}
+
+// plays one game, engines[first] plays white
+static GameResult playGame(const MatchOptions& options, const book::Book* openingBook, const tablebase::Table* table,
+		const Opening& opening, int first) {
+	GameResult result;
+	Board board = opening.board;
+	result.moveids = opening.moveids;
+	std::unique_ptr<Player> engines[2];
+	for (int i = 0; i < 2; ++i) {
+		engines[i].reset(createPlayer(options.specs[i]));
+		engines[i]->verbose = false;
+		engines[i]->book = openingBook;
+		engines[i]->tablebase = table;
+	}
+
+	result.winner = -1;
+	while (result.plies < options.maxPlies) {
+		int winner = board.getWinner();
+		if (winner != 0) {
+			result.winner = winner > 0 ? first : 1 - first;
+			break;
+		}
+
+		const int cur = board.playerTurn > 0 ? first : 1 - first;
+		auto start = std::chrono::steady_clock::now();
+		Board next = engines[cur]->makeAMove(board);
+		auto end = std::chrono::steady_clock::now();
+
+		result.thinkMs[cur] += std::chrono::duration<double, std::milli>(end - start).count();
+		result.moves[cur]++;
+		result.plies++;
+
+		// NOTE: an engine that has no move to make just hands back the board, call that a draw
+		if (next == board) break;
+
+		// players hand back boards, recover the move for the game record
+		if (!options.recordFile.empty()) {
+			for (const Move& move : board.get_moves()) {
+				Board after = board;
+				move.apply(after);
+				if (after == next) {
+					result.moveids.push_back(move.moveid);
+					break;
+				}
+			}
+		}
+		board = next;
+	}
+	return result;
+}
+
+static void runMatch(const MatchOptions& options, const book::Book* openingBook, const tablebase::Table* table,
+		const std::vector<Opening>& openings, MatchStats* stats, record::Writer* records) {
+	std::atomic<int> next(0);
+	std::atomic<bool> stop(false);
+	std::mutex lock;
+	const int games = openings.size() * 2;
+	stats::SPRT sprt(options.elo0, options.elo1, options.alpha, options.beta);
+
+	auto worker = [&]() {
+		int game;
+		while (!stop && (game = next++) < games) {
+			const int first = game % 2; // engine A plays white in even games
+			GameResult result = playGame(options, openingBook, table, openings[game / 2], first);
+
+			std::lock_guard<std::mutex> guard(lock);
+			const int outcome = result.winner < 0 ? 0 : (result.winner == 0 ? 1 : -1);
+			stats->results.add(outcome);
+			if (records->isOpen()) {
+				const int8_t white = result.winner < 0 ? 0 : (result.winner == first ? 1 : -1);
+				records->writeGame(result.moveids, white);
+			}
+			for (int i = 0; i < 2; ++i) {
+				stats->thinkMs[i] += result.thinkMs[i];
+				stats->moves[i] += result.moves[i];
+			}
+
+			// NOTE: games still in flight once the test decides are counted, but the decision stands
+			if (options.sprt && stats->decision == 0) {
+				sprt.add(outcome);
+				stats->decision = sprt.status();
+				if (stats->decision != 0) stop = true;
+			}
+
+			if (options.verbose) {
+				const stats::Results& results = stats->results;
+				std::cout << "game " << game + 1 << "/" << games << ": opening " << game / 2 + 1
+					<< ", " << (first == 0 ? "A" : "B") << " white, "
+					<< (result.winner < 0 ? "draw" : (result.winner == 0 ? "A wins" : "B wins"))
+					<< " in " << result.plies << " plies"
+					<< " (A " << results.wins << " - D " << results.draws << " - B " << results.losses << ")";
+				if (options.sprt)
+					std::cout << " llr " << sprt.llr() << " [" << sprt.lowerBound() << ", " << sprt.upperBound() << "]";
+				std::cout << std::endl;
+			}
+		}
+	};
+
+	std::vector<std::thread> pool;
+	for (int i = 0; i < options.threads; ++i)
+		pool.push_back(std::thread(worker));
+	for (std::thread& thread : pool)
+		thread.join();
+}
+
+int main(int argc, char **argv) {
+	MatchOptions options;
+	options.threads = std::thread::hardware_concurrency();
+
+	int opt;
+	while ((opt = getopt(argc, argv, "n:j:o:p:m:s:r:b:t:w:v")) != -1) {
+		switch (opt) {
+			case 'n': options.games = atoi(optarg); break;
+			case 'j': options.threads = atoi(optarg); break;
+			case 'o': options.openingsFile = optarg; break;
+			case 'p': options.openingPlies = atoi(optarg); break;
+			case 'm': options.maxPlies = atoi(optarg); break;
+			case 's':
+				options.sprt = sscanf(optarg, "%lf,%lf,%lf,%lf", &options.elo0, &options.elo1, &options.alpha, &options.beta) >= 2;
+				if (!options.sprt) {
+					usage(argv[0]);
+					return 1;
+				}
+				break;
+			case 'r': options.recordFile = optarg; break;
+			case 'b': options.bookFile = optarg; break;
+			case 't': options.tablebaseFile = optarg; break;
+			case 'w':
+				if (!eval::loadWeights(optarg)) {
+					std::cerr << "failed to load weights from " << optarg << std::endl;
+					return 1;
+				}
+				break;
+			case 'v': options.verbose = true; break;
+			default: usage(argv[0]); return 1;
+		}
+	}
+
+	if (argc - optind != 2) {
+		usage(argv[0]);
+		return 1;
+	}
+	for (int i = 0; i < 2; ++i) {
+		options.specs[i] = argv[optind + i];
+		std::unique_ptr<Player> check(createPlayer(options.specs[i]));
+		if (!check) {
+			std::cerr << "invalid engine: " << options.specs[i] << std::endl;
+			return 1;
+		}
+	}
+	if (options.threads < 1) options.threads = 1;
+
+	std::vector<Opening> openings;
+	if (!options.openingsFile.empty()) {
+		if (!loadOpenings(options.openingsFile, &openings)) {
+			std::cerr << "failed to load openings from " << options.openingsFile << std::endl;
+			return 1;
+		}
+		// NOTE: cycle through the file if more games are asked for than there are openings
+		std::vector<Opening> file = openings;
+		while ((int)openings.size() * 2 < options.games)
+			openings.push_back(file[openings.size() % file.size()]);
+		openings.resize((options.games + 1) / 2, openings[0]);
+	} else {
+		for (int i = 0; i < (options.games + 1) / 2; ++i)
+			openings.push_back(randomOpening(options.openingPlies));
+	}
+
+	std::cout << "A: " << options.specs[0] << "\nB: " << options.specs[1] << "\n"
+		<< openings.size() * 2 << " games on " << options.threads << " threads" << std::endl;
+
+	record::Writer games;
+	if (!options.recordFile.empty()) {
+		if (!options.openingsFile.empty()) {
+			std::cerr << "game records start from the empty board and cannot be used with an openings file" << std::endl;
+			return 1;
+		}
+		if (!games.open(options.recordFile, record::GAME_MAGIC)) {
+			std::cerr << "failed to open " << options.recordFile << std::endl;
+			return 1;
+		}
+	}
+
+	book::Book openingBook;
+	if (!options.bookFile.empty() && !openingBook.open(options.bookFile)) {
+		std::cerr << "failed to open book " << options.bookFile << std::endl;
+		return 1;
+	}
+
+	tablebase::Table table;
+	if (!options.tablebaseFile.empty() && (!table.open(options.tablebaseFile) || table.boardSize() != Board::SIZE)) {
+		std::cerr << "failed to open a " << Board::SIZE << "x" << Board::SIZE << " tablebase " << options.tablebaseFile << std::endl;
+		return 1;
+	}
+
+	MatchStats stats;
+	auto start = std::chrono::steady_clock::now();
+	runMatch(options, options.bookFile.empty() ? nullptr : &openingBook, options.tablebaseFile.empty() ? nullptr : &table,
+		openings, &stats, &games);
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	const stats::Results& results = stats.results;
+	double margin;
+	double elo = stats::elo(results, &margin);
+	std::cout << "\nA " << results.wins << " - D " << results.draws << " - B " << results.losses
+		<< " (score for A " << results.score() << ")" << std::endl;
+	std::cout << "elo A - B: " << elo << " +/- " << margin << std::endl;
+	if (options.sprt) {
+		std::cout << "SPRT elo0 " << options.elo0 << ", elo1 " << options.elo1 << ": "
+			<< (stats.decision > 0 ? "H1 accepted" : (stats.decision < 0 ? "H0 accepted" : "inconclusive")) << std::endl;
+	}
+	std::cout << results.games() << " games in " << seconds << "s, " << results.games() / seconds << " games/s" << std::endl;
+	for (int i = 0; i < 2; ++i) {
+		std::cout << (i == 0 ? "A" : "B") << " average move time: "
+			<< (stats.moves[i] ? stats.thinkMs[i] / stats.moves[i] : 0) << "ms" << std::endl;
+	}
+	return 0;
+}
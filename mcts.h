@@ -5,6 +5,13 @@
 #include <iostream>
 #include <chrono>
 #include <cstdlib>
+#include <new>
+#include <algorithm>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include <stdint.h>
 
 #ifndef MCTS_H
 #define MCTS_H
@@ -36,6 +43,16 @@ protected:
 	virtual void print(std::ostream &strm) {strm << this;};
 
 public:
+	/**
+	 * @brief Calculate a hash of this state
+	 *
+	 * @note Implementing this is only required when transpositions are enabled. See MCTS::setTranspositions(). Two
+	 * states with the same hash are treated as the same position, so the hash must also distinguish the player to move
+	 * and any move counter that keeps the search graph acyclic.
+	 * @return The unique (over all reachable states in the game) hash of this state
+	 */
+	virtual uint64_t hash() {return 0;};
+
 	virtual ~State(){};
 };
 
@@ -46,6 +63,10 @@ public:
  *
  * <b>Action must implement a copy constructor.</b>
  *
+ * When PROG_HIST or RAVE is defined, Action must also implement <b>unsigned int id()</b> returning a small integer that
+ * is unique over all possible actions in the game, including the player performing it. The id is used to index flat
+ * statistics tables, so it should be dense. It does not need to be virtual, MCTS calls it on the concrete type A.
+ *
  * @tparam The State type this Action can be executed on
  */
 template<class T>
@@ -70,47 +91,9 @@ public:
 	 */
 	virtual void execute(T* state)=0;
 
-	/**
-	 * @brief Calculate a hash of this action
-	 *
-	 * @noteImplementing this is only required when using progressive history. See MCTS for more details.
-	 * @return The unique (over all possible actions in the game) hash of this action
-	 */
-	virtual size_t hash() {return 0;};
-
-	/**
-	 * @brief Returns true when this Action equals the given action
-	 *
-     * @note Implementing this is only required when using progressive history. See MCTS for more details.
-	 * @return True if this and other are equal, false if not
-	 */
-	virtual bool equals(Action<T>* other) { return this==other; };
-
 	virtual ~Action(){};
 };
 
-namespace std {
-    /**
-     * Hash specialization for Action pointers used in the Progressive History technique in MCTS.
-     */
-    template<class T>
-    class hash<Action<T>*>{
-    public:
-        size_t operator() (Action<T>* const & a) const {
-            return a->hash();
-        }
-    };
-
-    /**
-     * equal_to specialization for Action pointers used in the Progressive History technique in MCTS.
-     */
-    template<class T>
-    class equal_to<Action<T>*>{
-    public :
-        bool operator() (Action<T>* const & x, Action<T>* const & y) const {return x->equals(y);}
-    };
-}
-
 /**
  * @brief Base class for strategies
  *
@@ -159,6 +142,16 @@ public:
 	 */
 	virtual bool canGenerateNext()=0;
 
+	/**
+	 * @brief The prior probability of the Action generateNext() returns next
+	 *
+	 * Only used by PUCT (see MCTS::setPuct()). The priors of all actions of a state should sum to about 1, and
+	 * generateNext() should return the actions with the highest prior first. By default all actions are equal.
+	 *
+	 * @return The prior of the next Action
+	 */
+	virtual float nextPrior() { return 1; }
+
 	virtual ~ExpansionStrategy() override {}
 };
 
@@ -186,6 +179,18 @@ public:
 	 */
 	virtual void generateRandom(A* action)=0;
 
+	/**
+	 * @brief Play Strategy#state out to the end of the game in one call
+	 *
+	 * Implementing this is optional, games with a dedicated playout engine can use it to avoid generating one Action
+	 * at a time. The state is modified in place. It is usually terminal afterwards, but an engine may also stop early
+	 * when Scoring can estimate the score of the state it stopped in.
+	 *
+	 * @param actions When not nullptr, the ids of the actions done should be appended (see Action)
+	 * @return True if the playout was done, false to fall back to generateRandom()
+	 */
+	virtual bool playout(std::vector<unsigned int>* /*actions*/) { return false; }
+
 	virtual ~PlayoutStrategy() override {}
 };
 
@@ -284,11 +289,28 @@ class Node{
 	T* data;
 	Node<T,A,E>* parent;
 	std::vector<Node<T,A,E>*> children;
-	/** Action done to get from the parent to this node */
+	/** Actions leading to each of the children, owned by this node */
+	std::vector<A*> childActions;
+	/**
+	 * Statistics of the edges to the children, stored contiguously so that selection can scan them without visiting
+	 * the children. Scores are from the point of view of the player moving into the child, like Node::score.
+	 */
+	std::vector<int32_t> childVisits;
+	std::vector<float> childScores;
+	/** Prior probability of the edges to the children, used by PUCT */
+	std::vector<float> childPriors;
+	/** All-moves-as-first statistics of the edges to the children, used by RAVE */
+	std::vector<int32_t> childAmafVisits;
+	std::vector<float> childAmafScores;
+	/** Action done to get from the parent to this node, owned by the parent (or by this node if it is the root) */
 	A* action;
 	ExpansionStrategy<T,A>* expansion;
 	int numVisits;
 	float score;
+	/** 1 if this node is a proven win for the player who moved into it, -1 if it is a proven loss, 0 if unknown */
+	int8_t proven;
+	/** Number of nodes that have this node as a child */
+	unsigned int numParents;
 
 public:
     /**
@@ -302,7 +324,7 @@ public:
      * @param parent The parent node
      * @param action The action taken to get to this node from the parent node
      */
-	Node(unsigned int id, T* data, Node<T,A,E>* parent, A* action) : id(id), data(data), parent(parent), action(action), expansion(new E(data)), numVisits(0), score(0) {
+	Node(unsigned int id, T* data, Node<T,A,E>* parent, A* action) : id(id), data(data), parent(parent), action(action), expansion(new E(data)), numVisits(0), score(0), proven(0), numParents(0) {
 	};
 
 	/**
@@ -320,7 +342,8 @@ public:
 	}
 
 	/**
-	 * @return This Node's parent or nullptr if no parent exists (this Node is the root)
+	 * @return The parent that created this Node or nullptr if no parent exists (this Node is the root). When
+	 * transpositions are enabled a Node can be linked from more than one parent, this only returns the first.
 	 */
 	Node<T,A,E>* getParent(){
 		return parent;
@@ -333,6 +356,13 @@ public:
 		return children;
 	}
 
+	/**
+	 * @return The Actions to execute on this Node's State to get to the State of each of the children
+	 */
+	std::vector<A*>& getChildActions(){
+		return childActions;
+	}
+
 	/**
 	 * @return The Action to execute on the parent's State to get from the parent's State to this Node's State.
 	 */
@@ -347,12 +377,94 @@ public:
 		return expansion->generateNext();
 	}
 
+	/**
+	 * @return The prior probability of the action generateNextAction() returns next
+	 */
+	float nextPrior(){
+		return expansion->nextPrior();
+	}
+
 	/**
 	 * @brief Add a child to this Node's children
+	 *
+	 * The statistics of the new edge start out as those of the child, which only has any when it is linked as a
+	 * transposition.
+	 *
 	 * @param child The child to add
+	 * @param action The action leading to the child, ownership is taken by this Node
+	 * @param prior The prior probability of the action
 	 */
-	void addChild(Node<T,A,E>* child){
+	void addChild(Node<T,A,E>* child, A* action, float prior){
 		children.push_back(child);
+		childActions.push_back(action);
+		childVisits.push_back(child->numVisits);
+		childScores.push_back(child->score);
+		childPriors.push_back(prior);
+		childAmafVisits.push_back(0);
+		childAmafScores.push_back(0);
+		child->numParents++;
+	}
+
+	/**
+	 * @return The number of visits of the edge to each child
+	 */
+	const int32_t* getChildVisits(){
+		return childVisits.data();
+	}
+
+	/**
+	 * @return The total score of the edge to each child
+	 */
+	const float* getChildScores(){
+		return childScores.data();
+	}
+
+	/**
+	 * @return The prior probability of the edge to each child
+	 */
+	const float* getChildPriors(){
+		return childPriors.data();
+	}
+
+	/**
+	 * @return The average score of the edge to the given child
+	 */
+	float getChildAvgScore(unsigned int i){
+		return childScores[i]/childVisits[i];
+	}
+
+	/**
+	 * @return The number of all-moves-as-first visits of the edge to each child
+	 */
+	const int32_t* getChildAmafVisits(){
+		return childAmafVisits.data();
+	}
+
+	/**
+	 * @return The total all-moves-as-first score of the edge to each child
+	 */
+	const float* getChildAmafScores(){
+		return childAmafScores.data();
+	}
+
+	/**
+	 * @brief Update the score and increment the number of visits of the edge to a child
+	 * @param i The index of the child
+	 * @param score The score from the point of view of the player moving into the child
+	 */
+	void updateChild(unsigned int i, float score){
+		childScores[i] += score;
+		childVisits[i]++;
+	}
+
+	/**
+	 * @brief Update the all-moves-as-first statistics of the edge to a child
+	 * @param i The index of the child
+	 * @param score The score from the point of view of the player moving into the child
+	 */
+	void updateChildAmaf(unsigned int i, float score){
+		childAmafScores[i] += score;
+		childAmafVisits[i]++;
 	}
 
 	/**
@@ -364,6 +476,13 @@ public:
 		return result;
 	}
 
+	/**
+	 * @return True if every possible child has been added
+	 */
+	bool isFullyExpanded(){
+		return !expansion->canGenerateNext();
+	}
+
 	/**
 	 * @brief Update this Node's score and increment the number of visits.
 	 * @param score
@@ -387,15 +506,112 @@ public:
 		return numVisits;
 	}
 
+
+	/**
+	 * @return 1 if this Node is a proven win for the player who moved into it, -1 if a proven loss and 0 if unknown
+	 */
+	int getProven(){
+		return proven;
+	}
+
+	/**
+	 * @brief Mark this Node as a proven win (1) or loss (-1) for the player who moved into it
+	 */
+	void setProven(int proven){
+		this->proven=proven;
+	}
+
+	/**
+	 * @brief Forget the children of this Node without deleting them
+	 *
+	 * Used when the nodes are shared between several parents and are deleted by their owner instead.
+	 */
+	void releaseChildren(){
+		children.clear();
+	}
+
+	/**
+	 * @brief Unlink all children and expand this Node again from scratch
+	 *
+	 * The statistics of this Node already include every visit of its children, so they are kept as they are. The
+	 * children are not deleted, the caller is responsible for deleting the ones that have no other parent left.
+	 */
+	void resetChildren(){
+		for (unsigned int i=0; i<children.size(); i++){
+			children[i]->numParents--;
+			if (children[i]->parent==this){
+				children[i]->parent=nullptr;
+				children[i]->action=nullptr;
+			}
+			delete childActions[i];
+		}
+		children.clear();
+		childActions.clear();
+		childVisits.clear();
+		childScores.clear();
+		childPriors.clear();
+		childAmafVisits.clear();
+		childAmafScores.clear();
+		delete expansion;
+		expansion=new E(data);
+	}
+
+	/**
+	 * @return The number of Nodes that have this Node as a child
+	 */
+	unsigned int getNumParents(){
+		return numParents;
+	}
+
 	~Node(){
 		delete data;
-		delete action;
 		delete expansion;
+		if (!parent)
+			delete action;
+		for (A* a : childActions)
+			delete a;
 		for (Node<T,A,E>* child : children)
 			delete child;
 	}
 };
 
+/**
+ * @brief Find the index of the largest of n values, the first one on ties
+ *
+ * Uses SSE to compare four lanes at a time when it is available.
+ */
+inline unsigned int argmax(const float* values, unsigned int n){
+	unsigned int best=0;
+	#ifdef __SSE2__
+	if (n>=8){
+		unsigned int i=4;
+		__m128 lanes=_mm_loadu_ps(values);
+		for (; i+4<=n; i+=4)
+			lanes=_mm_max_ps(lanes, _mm_loadu_ps(values+i));
+		float maxLanes[4];
+		_mm_storeu_ps(maxLanes, lanes);
+		float max=std::max(std::max(maxLanes[0], maxLanes[1]), std::max(maxLanes[2], maxLanes[3]));
+		for (; i<n; i++)
+			max=std::max(max, values[i]);
+
+		const __m128 target=_mm_set1_ps(max);
+		for (i=0; i+4<=n; i+=4){
+			int mask=_mm_movemask_ps(_mm_cmpeq_ps(_mm_loadu_ps(values+i), target));
+			if (mask)
+				return i+__builtin_ctz(mask);
+		}
+		for (; i<n; i++)
+			if (values[i]==max)
+				return i;
+		return best;
+	}
+	#endif
+	for (unsigned int i=1; i<n; i++)
+		if (values[i]>values[best])
+			best=i;
+	return best;
+}
+
 /**
  * @brief AI search technique for finding the best Action give a certain State
  *
@@ -404,20 +620,48 @@ public:
  * rules.
  *
  * In the selection stage, MCTS uses the UCT formula to select the best node (or randomly if a node has not been
- * visited often enough, see MCTS::setMinVisits()) until it finds a node that still has nodes left to be expanded. The
+ * visited often enough, see MCTS::setMinVisits()) until it finds a node that still has nodes left to be expanded.
+ * Selection only reads the edge statistics a node keeps for its children, so it scans a few contiguous arrays and takes
+ * the logarithm once per node.
+ *
+ * When PUCT is enabled (see MCTS::setPuct()), the exploration term of a child is weighted by the prior probability of
+ * its action from ExpansionStrategy::nextPrior() instead of the UCT term, and a node no longer has to be fully expanded
+ * before selection continues below it: the next unexpanded action competes with the children, scored with its prior
+ * and the average score of its siblings, and is expanded when it wins. The
  * UCT formula has one parameter, see MCTS::setC(). When PROG_HIST is defined, the progressive history heuristic is used
  * to influence the selection based on the success of an action during the playout stage. MCTS::setW() is used to set
- * the W parameter for progressive history.
+ * the W parameter for progressive history. When RAVE is defined, the average score of a node is blended with its
+ * all-moves-as-first (AMAF) score: every action played later in the iteration by the same player counts as a visit of
+ * the sibling reached by that action. MCTS::setRaveK() sets the number of visits at which both count equally. Both
+ * heuristics keep their statistics in flat arrays indexed by the action id (see Action), so updating them does not
+ * allocate.
  *
  * In the expansion stage an action is requested from the ExpansionStrategy and a node is expanded using that action.
  * When a node is not visited at least T times, expansion is skipped (see MCTS::setMinT()).
  *
  * In the playout stage, the PlayoutStrategy is used to generate moves until the end of the game is reached. When a
- * terminal state (the end of the game) is encoutered, the score is calculated using Scoring.
+ * terminal state (the end of the game) is encoutered, the score is calculated using Scoring. A single PlayoutStrategy
+ * acts on a copy of the state on the stack, and PlayoutStrategy::playout() is used when it is implemented.
+ *
+ * In the backpropagation stage, Node::update() is called for each node on the path from the root node to the node
+ * expanded in the expansion stage. The score passed to Node::update() is the one from the call to Scoring::score() passed
+ * to Backpropagation::updateScore() for each call to Node::update().
+ *
+ * When transpositions are enabled (see MCTS::setTranspositions()) the tree becomes a directed acyclic graph. Before a
+ * new node is created, State::hash() of the expanded state is looked up in a table of all nodes, and if the position
+ * was already reached through another parent the existing node is linked instead. Because a node can then have several
+ * parents, backpropagation follows the path taken during selection rather than the parent pointers.
+ *
+ * When the solver is enabled (see MCTS::setSolver()), terminal states are marked as proven wins or losses and this is
+ * propagated up the tree: a node is lost for the player who moved into it if any child is a proven win for the player
+ * to move, and won if it is fully expanded and every child is a proven loss. Proven children are skipped by selection,
+ * and the search stops as soon as the root is proven. The solver assumes the players alternate between a node and its
+ * children, and that Scoring returns 1 for a win and 0 for a loss after Backpropagation::updateScore().
  *
- * In the backpropagation stage, Node::update() is called for each node from the node expanded in the expansion stage
- * to the root node. The score passed to Node::update() is the one from the call to Scoring::score() passed to
- * Backpropagation::updateScore() for each call to Node::update().
+ * The number of nodes can be bounded with MCTS::setMaxNodes(). When the budget is reached the least visited subtrees
+ * whose children are all leaves are pruned back to a single leaf, until PRUNE_RATIO of the budget is in use. The pruned
+ * node keeps its statistics (which already include every visit of its children) and is expanded again from scratch
+ * when it is selected. The memory of pruned nodes is recycled for new ones.
  *
  * The time that MCTS is allowed to search van be set by MCTS::setTime().
  *
@@ -440,22 +684,69 @@ class MCTS {
 	/** Default W for the progressive history formula */
 	static constexpr float DEFAULT_W=0.0;
 
+	/** Default equivalence parameter for RAVE, 0 disables the AMAF term */
+	static constexpr float DEFAULT_RAVE_K=0.0;
+
+	/** Default exploration constant for PUCT */
+	static constexpr float DEFAULT_C_PUCT=1.0;
+
+	/** Returned by select() when the node is proven by its children */
+	static const unsigned int SELECT_SOLVED=(unsigned int)-1;
+
+	/** Returned by select() when the next unexpanded action should be expanded, only with PUCT */
+	static const unsigned int SELECT_EXPAND=(unsigned int)-2;
+
 	/** Minimum number of visits until a Node will be expanded */
 	const int DEFAULT_MIN_T=5;
 
 	/** Default number of visits until a node can be selected using UCT instead of randomly */
 	const int DEFAULT_MIN_VISITS=5;
 
+	/** Fraction of the node budget that is in use after pruning */
+	static constexpr float PRUNE_RATIO=0.9;
+
 	Backpropagation<T>* backprop;
 	TerminationCheck<T>* termination;
 	Scoring<T>* scoring;
 
 	Node<T,A,E>* root;
 
-	/** Map holding the information for use in the Progressive History technique.
+	/** Every node in the search graph by State::hash(), only used when transpositions are enabled. Owns the nodes. */
+	std::unordered_map<uint64_t, Node<T,A,E>*> transpositions;
+
+	/** The nodes visited in the current iteration, from the root to the node that was played out */
+	std::vector<Node<T,A,E>*> path;
+
+	/** The children taken between the nodes in path, path[i+1] is child pathIndices[i] of path[i] */
+	std::vector<unsigned int> pathIndices;
+
+	/** UCT values of the children of the node being selected from, kept between selections to avoid allocating */
+	std::vector<float> selectScores;
+
+	/** Maximum number of nodes in the search, 0 for no limit */
+	unsigned long maxNodes;
+
+	/** Number of nodes currently in the search */
+	unsigned long numNodes;
+
+	/** Memory of pruned nodes to construct new ones in */
+	std::vector<void*> freeNodes;
+
+	/** Subtrees that can be pruned, kept between prunings to avoid allocating */
+	std::vector<Node<T,A,E>*> pruneCandidates;
+
+	/** Ids of the actions done in the playout stage of the current iteration */
+	std::vector<unsigned int> playoutActions;
+
+	/** Table holding the information for use in the Progressive History technique, indexed by Action id.
 	 * The value holds the number of times an Action was done and the score that action led to.
 	 */
-	std::unordered_map<Action<T>*, std::pair<int, float>> history;
+	std::vector<std::pair<int, float>> history;
+
+	/** Iteration in which an Action id was last done by the player to move at even (index id*2) or odd (id*2+1) depth,
+	 * used by RAVE to find the actions that came after a node without clearing a table every iteration.
+	 */
+	std::vector<long> amafSeen;
 
 	/** The time MCTS is allowed to search */
 	milliseconds time;
@@ -469,12 +760,27 @@ class MCTS {
 	/** Tunable parameter determining the influence of history */
 	float W;
 
+	/** Tunable number of visits at which the AMAF score and the average score are weighted equally */
+	float raveK;
+
+	/** Select with PUCT and the priors of the actions instead of UCT */
+	bool usePuct;
+
+	/** Tunable exploration constant for PUCT */
+	float cPuct;
+
 	/** Minimum number of visits until a Node will be expanded */
 	int minT;
 
 	/** Minimum number of visits until a Node will be selected using the UCT formula, below this number random selection is used */
 	int minVisits;
 
+	/** Merge transposed positions into a single node */
+	bool useTranspositions;
+
+	/** Propagate proven wins and losses */
+	bool useSolver;
+
 	/** Variable to assign IDs to a node */
 	unsigned int currentNodeID;
 
@@ -483,6 +789,8 @@ class MCTS {
 	 */
 	microseconds selectTime, expandTime,simulateTime;
 	long iterations;
+	long transpositionHits;
+	long prunedNodes;
 
 public:
 	/**
@@ -490,10 +798,11 @@ public:
 	 */
 	MCTS(T* rootData, Backpropagation<T>* backprop, TerminationCheck<T>* termination, Scoring<T>* scoring) :
 	    backprop(backprop), termination(termination), scoring(scoring), root(new Node<T,A,E>(0, rootData, 0, new A())),
-	        history(), time(milliseconds(DEFAULT_TIME)), minIterations(DEFAULT_MIN_ITERATIONS), C(DEFAULT_C),
-	            W(DEFAULT_W), minT(DEFAULT_MIN_T), minVisits(DEFAULT_MIN_VISITS), currentNodeID(0),
-	                selectTime(microseconds::zero()), expandTime(microseconds::zero()),
-	                    simulateTime(microseconds::zero()), iterations(0) {}
+	        maxNodes(0), numNodes(1), history(), time(milliseconds(DEFAULT_TIME)), minIterations(DEFAULT_MIN_ITERATIONS), C(DEFAULT_C),
+	            W(DEFAULT_W), raveK(DEFAULT_RAVE_K), usePuct(false),
+	                cPuct(DEFAULT_C_PUCT), minT(DEFAULT_MIN_T), minVisits(DEFAULT_MIN_VISITS), useTranspositions(false),
+	                useSolver(false), currentNodeID(0), selectTime(microseconds::zero()), expandTime(microseconds::zero()),
+	                    simulateTime(microseconds::zero()), iterations(0), transpositionHits(0), prunedNodes(0) {}
 
 	/**
 	 * @brief Runs the MCTS algorithm and searches for the best Action
@@ -509,25 +818,32 @@ public:
         #ifdef _DEBUG
 		std::cerr << iterations << " iterations in " << duration_cast<milliseconds>(system_clock::now()-old).count() << "ms" << std::endl;
 		std::cerr << "Average select:" << (float)(selectTime.count()/1000)/iterations/1000 << "ms Average expand:" << (float)(expandTime.count())/iterations/1000 << "ms Average simulate:" << (float)(simulateTime.count())/iterations/1000 << "ms" << std::endl;
+		if (useTranspositions)
+			std::cerr << transpositions.size() << " nodes, " << transpositionHits << " transpositions linked" << std::endl;
+		if (maxNodes>0)
+			std::cerr << numNodes << " nodes, " << prunedNodes << " pruned" << std::endl;
+		if (useSolver && root->getProven()!=0)
+			std::cerr << "root proven " << (root->getProven()<0 ? "win" : "loss") << " for the player to move" << std::endl;
 		#endif
 
-		// Select the Action with the best score
-		Node<T,A,E>* best=nullptr;
+		// Select the Action with the best score, a proven win beats everything and proven losses are a last resort
+		A* best=nullptr;
 		float bestScore=-std::numeric_limits<float>::max();
 		std::vector<Node<T,A,E>*>& children=root->getChildren();
 
 		for (unsigned int i=0; i<children.size();i++){
-			float score=children[i]->getAvgScore();
-			if (score>bestScore){
+			float score=root->getChildAvgScore(i);
+			if (children[i]->getProven()>0)
+				score=std::numeric_limits<float>::max();
+			else if (children[i]->getProven()<0)
+				score=-std::numeric_limits<float>::max()/2;
+			if (best==nullptr || score>bestScore){
 				bestScore=score;
-				best=children[i];
+				best=root->getChildActions()[i];
 			}
 		}
 
-        for (auto kv : history)
-            std::cout << kv.first->hash() << " " << kv.second.first << std::endl;
-
-		return new A(*best->getAction());
+		return new A(*best);
 	}
 
 	/**
@@ -554,6 +870,31 @@ public:
 		this->W=W;
 	}
 
+    /**
+     * @brief Set the K parameter of RAVE, the number of visits at which the AMAF score counts as much as the average
+     * score of a node.
+     * @param raveK the K parameter
+     */
+	void setRaveK(float raveK){
+		this->raveK=raveK;
+	}
+
+    /**
+     * @brief Select with PUCT, weighting exploration by the priors from the ExpansionStrategy
+     * @param usePuct True to use PUCT instead of UCT
+     */
+	void setPuct(bool usePuct){
+		this->usePuct=usePuct;
+	}
+
+    /**
+     * @brief Set the exploration constant of PUCT
+     * @param cPuct The exploration constant
+     */
+	void setCPuct(float cPuct){
+		this->cPuct=cPuct;
+	}
+
     /**
      * @brief Set the minimal number of visits until a node is expanded
      * @param minT the minimal number of visits
@@ -570,6 +911,32 @@ public:
 	    this->minVisits = minVisits;
 	}
 
+    /**
+     * @brief Merge positions reached through different move orders into a single node
+     *
+     * Requires State::hash() to be implemented. Must be called before calculateAction().
+     * @param useTranspositions True to search a graph of positions instead of a tree
+     */
+	void setTranspositions(bool useTranspositions) {
+	    this->useTranspositions = useTranspositions;
+	}
+
+    /**
+     * @brief Propagate proven wins and losses and stop searching once the root is proven
+     * @param useSolver True to enable MCTS-Solver
+     */
+	void setSolver(bool useSolver) {
+	    this->useSolver = useSolver;
+	}
+
+    /**
+     * @brief Bound the number of nodes in the search, pruning the least visited subtrees when it is reached
+     * @param maxNodes The maximum number of nodes, 0 for no limit
+     */
+	void setMaxNodes(unsigned long maxNodes) {
+	    this->maxNodes = maxNodes;
+	}
+
 	/**
 	 * Get the root of the MCTS tree. Useful for printing.
 	 * @see writeDotFile()
@@ -580,10 +947,17 @@ public:
 	}
 
 	~MCTS(){
-		for (auto kv : history)
-			delete kv.first;
-
-		delete root;
+		if (useTranspositions && !transpositions.empty()){
+			// Nodes can have several parents, so delete each one exactly once through the table
+			for (auto kv : transpositions)
+				kv.second->releaseChildren();
+			for (auto kv : transpositions)
+				delete kv.second;
+		}
+		else
+			delete root;
+		for (void* memory : freeNodes)
+			::operator delete(memory);
 		delete backprop;
 		delete termination;
 		delete scoring;
@@ -597,7 +971,11 @@ private:
 		system_clock::time_point temp;
 		#endif
 
-		while (duration_cast<milliseconds>(system_clock::now()-old)<time || iterations < minIterations){
+		if (useTranspositions && transpositions.empty())
+			transpositions[root->getData()->hash()]=root;
+
+		while ((duration_cast<milliseconds>(system_clock::now()-old)<time || iterations < minIterations) &&
+		        !(useSolver && root->getProven()!=0)){
 
 			#ifdef _DEBUG
 			temp=system_clock::now();
@@ -606,15 +984,40 @@ private:
 
 			iterations++;
 
+			if (maxNodes>0 && numNodes>=maxNodes)
+				prune();
+
 			/**
 			 * Selection
 			 */
 			Node<T,A,E>* selected=root;
-			while(!selected->shouldExpand())
-				selected=select(selected);
+			path.clear();
+			pathIndices.clear();
+			playoutActions.clear();
+			path.push_back(selected);
+			bool solved=false;
+			while(!selected->getChildren().empty() && (usePuct || !selected->shouldExpand())){
+				unsigned int i=select(selected);
+				if (i==SELECT_SOLVED){
+					// every child is proven or one is a proven win, so this node is proven too
+					prove(solve(selected));
+					solved=true;
+					break;
+				}
+				if (i==SELECT_EXPAND)
+					break;
+				pathIndices.push_back(i);
+				selected=selected->getChildren()[i];
+				path.push_back(selected);
+			}
+			if (solved)
+				continue;
 
 			if (termination->isTerminal(selected->getData())){
-				backProp(selected, scoring->score(selected->getData()));
+				float score=scoring->score(selected->getData());
+				if (useSolver)
+					proveTerminal(score);
+				backProp(score);
 				continue;
 			}
 
@@ -630,6 +1033,10 @@ private:
 			int numVisits=selected->getNumVisits();
 			if (numVisits>=minT){
 				expanded=expandNext(selected);
+				path.push_back(expanded);
+				pathIndices.push_back(selected->getChildren().size()-1);
+				if (useSolver && expanded->getProven()==0 && termination->isTerminal(expanded->getData()))
+					proveTerminal(scoring->score(expanded->getData()));
 			}
 			else{
 				expanded=selected;
@@ -651,100 +1058,342 @@ private:
 		}
 	}
 
-	/** Selects the best child node at the given node */
-	Node<T,A,E>* select(Node<T,A,E>* node){
-		Node<T,A,E>* best=nullptr;
-		float bestScore=-std::numeric_limits<float>::max();
-
+	/**
+	 * Selects the best child node at the given node, returns its index in Node::getChildren(). With the solver enabled
+	 * proven children are skipped, and SELECT_SOLVED is returned when the node itself can be proven. With PUCT,
+	 * SELECT_EXPAND is returned when the next action should be expanded instead.
+	 */
+	unsigned int select(Node<T,A,E>* node){
 		std::vector<Node<T,A,E>*>& children=node->getChildren();
 
-		//Select randomly if the Node has not been visited often enough
-		if (node->getNumVisits()<minVisits)
-			return children[rand()%children.size()];
+		if (useSolver){
+			bool allProven=true;
+			for (Node<T,A,E>* n : children){
+				if (n->getProven()>0)
+					return SELECT_SOLVED;
+				if (n->getProven()==0)
+					allProven=false;
+			}
+			if (allProven)
+				return node->isFullyExpanded() ? SELECT_SOLVED : SELECT_EXPAND;
+		}
 
-		// Use the UCT formula for selection
-		for (Node<T,A,E>* n : children){
+		//Select randomly if the Node has not been visited often enough, PUCT relies on the priors instead
+		if (!usePuct && node->getNumVisits()<minVisits){
+			unsigned int i=rand()%children.size();
+			while (useSolver && children[i]->getProven()!=0)
+				i=rand()%children.size();
+			return i;
+		}
 
+		// Use the UCT formula for selection
+		// NOTE: the first loop is kept free of branches and calls so that it vectorizes
+		const unsigned int n=children.size();
+		selectScores.resize(n);
+		float* scores=selectScores.data();
+		const int32_t* visits=node->getChildVisits();
+		const float* sums=node->getChildScores();
+
+		if (usePuct){
+			const float* priors=node->getChildPriors();
+			const float exploration=cPuct*std::sqrt((float)node->getNumVisits());
+			for (unsigned int i=0; i<n; i++)
+				scores[i]=sums[i]/visits[i]+exploration*priors[i]/(1+visits[i]);
+		}
+		else{
+			const float exploration=C*std::sqrt(std::log((float)node->getNumVisits()));
+			for (unsigned int i=0; i<n; i++){
+				const float inverse=1.0f/visits[i];
+				scores[i]=sums[i]*inverse+exploration*std::sqrt(inverse);
+			}
+		}
 
-			float score=n->getAvgScore()+C*(float)sqrt(log(node->getNumVisits())/n->getNumVisits());
+		#ifdef RAVE
+		if (raveK>0){
+			const int32_t* amafVisits=node->getChildAmafVisits();
+			const float* amafSums=node->getChildAmafScores();
+			for (unsigned int i=0; i<n; i++){
+				if (amafVisits[i]==0)
+					continue;
+				const float avgScore=sums[i]/visits[i];
+				const float beta=std::sqrt(raveK/(3*visits[i]+raveK));
+				scores[i]+=beta*(amafSums[i]/amafVisits[i]-avgScore);
+			}
+		}
+		#endif
 
-			#ifdef PROG_HIST
-			auto stats=history.find(n->getAction());
-			if (stats!=history.end()){
-				score+=stats->second.second/stats->second.first*W/((1-n->getAvgScore())*n->getNumVisits()+1);
+		#ifdef PROG_HIST
+		if (W!=0){
+			for (unsigned int i=0; i<n; i++){
+				unsigned int id=node->getChildActions()[i]->id();
+				if (id<history.size() && history[id].first>0){
+					// history is kept from the point of view of Scoring, convert it like a backpropagated score
+					float historyScore=backprop->updateScore(children[i]->getData(), history[id].second/history[id].first);
+					scores[i]+=historyScore*W/((1-sums[i]/visits[i])*visits[i]+1);
+				}
 			}
-            #endif
+		}
+		#endif
 
+		if (useSolver)
+			for (unsigned int i=0; i<n; i++)
+				if (children[i]->getProven()!=0)
+					scores[i]=-std::numeric_limits<float>::max();
 
-			if (score>bestScore)
-			{
-				bestScore=score;
-				best=n;
+		unsigned int best=argmax(scores, n);
+
+		if (usePuct && !node->isFullyExpanded()){
+			// an unexpanded action is valued at the average of its siblings
+			float totalScore=0;
+			int32_t totalVisits=0;
+			for (unsigned int i=0; i<n; i++){
+				totalScore+=sums[i];
+				totalVisits+=visits[i];
 			}
+			float expandScore=totalScore/totalVisits+cPuct*std::sqrt((float)node->getNumVisits())*node->nextPrior();
+			if (expandScore>scores[best])
+				return SELECT_EXPAND;
 		}
 
 		return best;
 	}
-	/** Get the next Action for the given Node, execute and add the new Node to the tree. */
+	/**
+	 * Get the next Action for the given Node, execute and add the new Node to the tree. With transpositions enabled an
+	 * existing Node for the same position is linked instead when there is one.
+	 */
 	Node<T,A,E>* expandNext(Node<T,A,E>* node){
 		T* expandedData=new T(*node->getData());
+		float prior = node->nextPrior();
 		A* action = node->generateNextAction();
 		action->execute(expandedData);
-		Node<T,A,E>* newNode=new Node<T,A,E>(++currentNodeID, expandedData,node, action);
-		node->addChild(newNode);
+
+		if (useTranspositions){
+			uint64_t hash=expandedData->hash();
+			auto existing=transpositions.find(hash);
+			if (existing!=transpositions.end()){
+				transpositionHits++;
+				delete expandedData;
+				node->addChild(existing->second, action, prior);
+				return existing->second;
+			}
+			Node<T,A,E>* newNode=createNode(expandedData, node, action);
+			transpositions[hash]=newNode;
+			node->addChild(newNode, action, prior);
+			return newNode;
+		}
+
+		Node<T,A,E>* newNode=createNode(expandedData, node, action);
+		node->addChild(newNode, action, prior);
 		return newNode;
 	}
+
+	/** Create a Node, reusing the memory of a pruned one when possible */
+	Node<T,A,E>* createNode(T* data, Node<T,A,E>* parent, A* action){
+		void* memory;
+		if (!freeNodes.empty()){
+			memory=freeNodes.back();
+			freeNodes.pop_back();
+		}
+		else
+			memory=::operator new(sizeof(Node<T,A,E>));
+		numNodes++;
+		return new (memory) Node<T,A,E>(++currentNodeID, data, parent, action);
+	}
+
+	/** Destroy a Node that has no children and keep its memory for createNode() */
+	void recycleNode(Node<T,A,E>* node){
+		if (useTranspositions)
+			transpositions.erase(node->getData()->hash());
+		node->~Node<T,A,E>();
+		freeNodes.push_back(node);
+		numNodes--;
+		prunedNodes++;
+	}
+
+	/** Collect every node below the root whose children are all leaves */
+	void collectPruneCandidates(){
+		pruneCandidates.clear();
+		auto isCandidate=[this](Node<T,A,E>* node){
+			if (node==root || node->getChildren().empty())
+				return false;
+			for (Node<T,A,E>* child : node->getChildren())
+				if (!child->getChildren().empty())
+					return false;
+			return true;
+		};
+
+		if (useTranspositions){
+			for (auto kv : transpositions)
+				if (isCandidate(kv.second))
+					pruneCandidates.push_back(kv.second);
+			return;
+		}
+
+		// the tree is walked with path as the stack, it is cleared at the start of every iteration anyway
+		path.clear();
+		path.push_back(root);
+		while (!path.empty()){
+			Node<T,A,E>* node=path.back();
+			path.pop_back();
+			if (isCandidate(node))
+				pruneCandidates.push_back(node);
+			else
+				for (Node<T,A,E>* child : node->getChildren())
+					path.push_back(child);
+		}
+	}
+
+	/** Prune the least visited subtrees until PRUNE_RATIO of the node budget is in use */
+	void prune(){
+		unsigned long target=(unsigned long)(maxNodes*PRUNE_RATIO);
+		while (numNodes>target){
+			collectPruneCandidates();
+			if (pruneCandidates.empty())
+				return;
+
+			std::sort(pruneCandidates.begin(), pruneCandidates.end(), [](Node<T,A,E>* a, Node<T,A,E>* b){
+				return a->getNumVisits()<b->getNumVisits();
+			});
+
+			for (Node<T,A,E>* node : pruneCandidates){
+				if (numNodes<=target)
+					break;
+				// children are leaves, the ones not linked from another parent can be recycled
+				std::vector<Node<T,A,E>*> children=node->getChildren();
+				node->resetChildren();
+				for (Node<T,A,E>* child : children)
+					if (child->getNumParents()==0)
+						recycleNode(child);
+			}
+		}
+	}
 	/** Simulate until the stopping condition is reached. */
 	void simulate(Node<T,A,E>* node){
-		T* state=new T(*node->getData());
-		std::vector<Action<T>*> actions;
-
-        A action;
-		// Check if the end of the game is reached and generate the next state if not
-		while (!termination->isTerminal(state))
-		{
-			PlayoutStrategy<T,A>* playout=new P(state);
-			playout->generateRandom(&action);
-			action.execute(state);
-			#ifdef PROG_HIST
-			actions.push_back(new A(action));
-            #endif
-			delete playout;
+		T state(*node->getData());
+		P playout(&state);
+
+		#if defined(PROG_HIST) || defined(RAVE)
+		std::vector<unsigned int>* actions=&playoutActions;
+		#else
+		std::vector<unsigned int>* actions=nullptr;
+		#endif
+
+		if (!playout.playout(actions)){
+			A action;
+			// Check if the end of the game is reached and generate the next state if not
+			while (!termination->isTerminal(&state))
+			{
+				playout.generateRandom(&action);
+				action.execute(&state);
+				#if defined(PROG_HIST) || defined(RAVE)
+				playoutActions.push_back(action.id());
+				#endif
+			}
 		}
 
         // Score the leaf node (end of the game)
-		float s =scoring->score(state);
+		float s =scoring->score(&state);
 
 		#ifdef PROG_HIST
 		// Update progressive history statistics
-		for (Action<T>* a : actions){
-			auto i = history.find(a);
-			if (i!=history.end()){
-				std::pair<int, float> stats = i->second;
-				stats.first++;
-				stats.second+=s;
-				i->second=stats;
-
-				delete a;
-			}
-			else{
-				history[a]=std::pair<int, float>(1,s);
-			}
+		for (unsigned int id : playoutActions){
+			if (id>=history.size())
+				history.resize(id+1, std::pair<int, float>(0, 0));
+			history[id].first++;
+			history[id].second+=s;
 		}
         #endif
 
-		backProp(node, s);
-		delete state;
+		backProp(s);
+
+	}
+	/**
+	 * @return The proven value of a node from its children: a loss (-1) if the player to move has a winning child, a
+	 * win (1) if it is fully expanded and every child is lost, otherwise unknown (0)
+	 */
+	int solve(Node<T,A,E>* node){
+		std::vector<Node<T,A,E>*>& children=node->getChildren();
+		bool allLost=!children.empty() && node->isFullyExpanded();
+		for (Node<T,A,E>* n : children){
+			if (n->getProven()>0)
+				return -1;
+			if (n->getProven()==0)
+				allLost=false;
+		}
+		return allLost ? 1 : 0;
+	}
+
+	/** Mark the last node on the path as proven and update its ancestors on the path */
+	void prove(int proven){
+		if (proven==0)
+			return;
+		path.back()->setProven(proven);
+		for (size_t i=path.size()-1; i-->0;){
+			if (path[i]->getProven()!=0)
+				break;
+			int value=solve(path[i]);
+			if (value==0)
+				break;
+			path[i]->setProven(value);
+		}
+	}
 
+	/** Mark the terminal node at the end of the path as proven according to its score */
+	void proveTerminal(float score){
+		if (path.size()<2)
+			return;
+		float adjusted=backprop->updateScore(path.back()->getData(), score);
+		if (adjusted>=1)
+			prove(1);
+		else if (adjusted<=0)
+			prove(-1);
 	}
-	/** Backpropagate a score through the tree */
-	void backProp(Node<T,A,E>* node, float score){
-		while (node->getParent()!=0){
-			node->update(backprop->updateScore(node->getData(),score));
-			node=node->getParent();
+
+	/** Backpropagate a score along the path taken in this iteration */
+	void backProp(float score){
+		#ifdef RAVE
+		if (raveK>0)
+			updateAmaf(score);
+		#endif
+		for (size_t i=path.size()-1; i>0; i--){
+			float adjusted=backprop->updateScore(path[i]->getData(),score);
+			path[i]->update(adjusted);
+			path[i-1]->updateChild(pathIndices[i-1], adjusted);
+		}
+		path[0]->update(score);
+	}
+
+	#ifdef RAVE
+	/** Mark an action as done at the given depth in the current iteration */
+	void markAmaf(unsigned int id, size_t depth){
+		if (id*2+1>=amafSeen.size())
+			amafSeen.resize(id*2+2, 0);
+		amafSeen[id*2+(depth&1)]=iterations;
+	}
+
+	/**
+	 * Update the AMAF statistics of the children of every node on the path. Walking from the leaf to the root, all
+	 * actions done at or below a node are marked before its children are checked.
+	 */
+	void updateAmaf(float score){
+		size_t depth=path.size()-1;
+		for (size_t i=0; i<playoutActions.size(); i++)
+			markAmaf(playoutActions[i], depth+i);
+
+		for (size_t d=path.size(); d-->0;){
+			if (d<pathIndices.size())
+				markAmaf(path[d]->getChildActions()[pathIndices[d]]->id(), d);
+
+			std::vector<Node<T,A,E>*>& children=path[d]->getChildren();
+			std::vector<A*>& actions=path[d]->getChildActions();
+			for (size_t i=0; i<children.size(); i++){
+				unsigned int id=actions[i]->id();
+				if (id*2+1<amafSeen.size() && amafSeen[id*2+(d&1)]==iterations)
+					path[d]->updateChildAmaf(i, backprop->updateScore(children[i]->getData(),score));
+			}
 		}
-		node->update(score);
 	}
+	#endif
 };
 
 #endif
@@ -1,151 +1,8 @@
 #include <algorithm>
-#include <sstream>
-#include "board.h"
+#include "movegen.h"
 #include "helpers.h"
 
-/**
-	move generation
-*/
-
-struct MoveInternal {
-	const static int8_t TYPE_PLACE = 1;
-	const static int8_t TYPE_SPLIT = 2;
-	const static int8_t TYPE_SPLIT_SQUASH = 3;
-
-	MoveInternal() { bzero(this, sizeof(MoveInternal)); };
-
-	uint32_t moveid;
-
-	int8_t type = 0;
-
-	int8_t position;
-	int8_t piece;
-
-	int8_t split_count;
-	int8_t split_positions[Board::SIZE];
-	int8_t split_sizes[Board::SIZE];
-
-	std::string toString() {
-		std::stringstream ss;
-
-		if (type == TYPE_PLACE) {
-			ss << "place " << (char)('A' + position % Board::SIZE) << (int) 1 + position / Board::SIZE << piece_to_string(piece) << std::endl;
-		} else if (type == TYPE_SPLIT || type == TYPE_SPLIT_SQUASH) {
-			if (type == TYPE_SPLIT_SQUASH) {
-				ss << "ITS A SQUASHER!" << std::endl;
-			}
-
-			ss << "split " << (char)('A' + position % Board::SIZE) << (int) 1 + position / Board::SIZE << std::endl;
-			for (int i = 0; i < split_count; ++i) {
-				int position = split_positions[i];
-				ss << "\t#" << (int) split_sizes[i] << " - " << (char)('A' + position % Board::SIZE) << (int) 1 + position / Board::SIZE << std::endl;
-			}
-		}
-
-		return ss.str();
-	}
-
-	inline static int8_t piece_color(const Board& board) {
-		return board.placementColor();
-	}
-
-	bool can_move(const Board& board) {
-		if (type == TYPE_PLACE) {
-			int8_t piece = this->piece * MoveInternal::piece_color(board);
-			if (board.moveno < 2) return piece == PIECE_FLAT || piece == -PIECE_FLAT;
-			switch (piece) {
-			case PIECE_CAP: return board.capstones[0] > 0;
-			case -PIECE_CAP: return board.capstones[1] > 0;
-			case PIECE_WALL:
-			case PIECE_FLAT: return board.piecesleft[0] > 0;
-			case -PIECE_WALL:
-			case -PIECE_FLAT: return board.piecesleft[1] > 0;
-			default:
-				exit(0);
-			}
-		} else if(type == TYPE_SPLIT) {
-			for (int i = 0; i < split_count; ++i) {
-				const int8_t landingOn = board.stacks[split_positions[i]].top();
-				if (landingOn == PIECE_WALL || landingOn == -PIECE_WALL || landingOn == PIECE_CAP || landingOn == -PIECE_CAP) return false;
-			}
-			return true;
-		} else if (type == TYPE_SPLIT_SQUASH) {
-			for (int i = 0; i < split_count - 1; ++i) {
-				const int8_t landingOn = board.stacks[split_positions[i]].top();
-				if (landingOn == PIECE_WALL || landingOn == -PIECE_WALL || landingOn == PIECE_CAP || landingOn == -PIECE_CAP) return false;
-			}
-			int8_t top = board.stacks[split_positions[split_count - 1]].top();
-			return top == PIECE_WALL || top == -PIECE_WALL;
-		}
-		return false;
-	}
-
-	void apply(Board& board) const {
-		assert(type != 0);
-		const int8_t piece_color = MoveInternal::piece_color(board);
-		board.playerTurn = -board.playerTurn;
-		board.moveno++;
-		if (type == TYPE_PLACE) {
-			board.place(position, piece * piece_color);
-			switch (piece * piece_color) {
-			case PIECE_CAP: board.capstones[0]--; break ;
-			case -PIECE_CAP: board.capstones[1]--; break ;
-			case PIECE_FLAT:
-			case PIECE_WALL: board.piecesleft[0]--; break ;
-			case -PIECE_FLAT:
-			case -PIECE_WALL: board.piecesleft[1]--; break ;
-			}
-			return ;
-		}
-
-		for (int8_t i = split_count - 1; i >= 0; --i) {
-			board.move(position, split_positions[i], split_sizes[i]);
-		}
-	}
-
-	void revert(Board& board) const {
-		assert(type != 0);
-		board.moveno--;
-		board.playerTurn = -board.playerTurn;
-		const int8_t piece_color = MoveInternal::piece_color(board);
-		if (type == TYPE_PLACE) {
-			board.remove(position);
-			switch (piece * piece_color) {
-			case PIECE_CAP: board.capstones[0]++; break ;
-			case -PIECE_CAP: board.capstones[1]++; break ;
-			case PIECE_FLAT:
-			case PIECE_WALL: board.piecesleft[0]++; break ;
-			case -PIECE_FLAT:
-			case -PIECE_WALL: board.piecesleft[1]++; break ;
-			}
-			return ;
-		}
-
-		for (int8_t i = 0; i < split_count; ++i) {
-			board.move(split_positions[i], position, split_sizes[i]);
-		}
-
-		if (type == TYPE_SPLIT_SQUASH) {
-			board.remove(position);
-			board.place(position, PIECE_CAP * piece_color);
-
-			const int8_t last = split_positions[split_count - 1];
-			const int8_t wall = board.stacks[last].top() > 0 ? PIECE_WALL : -PIECE_WALL;
-			board.remove(last);
-			board.place(last, wall);
-		}
-	}
-};
-
 namespace movegen {
-	std::vector<MoveInternal> all_moves;
-
-	MoveInternal placements[Board::SQUARES][3];
-
-	std::vector<MoveInternal> cuts[Board::SQUARES][Board::SIZE + 1]; // 0 index isn't used
-	std::vector<MoveInternal> cuts_flatten[Board::SQUARES][Board::SIZE + 1]; // 0 index isn't used
-
-
 	// generate all sequences of integers that reach the sum 'n'
 	void target_sum(int n, std::vector<int> current, std::vector<std::vector<int>>& results) {
 		for (int i = 1; i < n; ++i) {
@@ -159,10 +16,11 @@ namespace movegen {
 	}
 
 	// generate all moves that reach length given
-	std::vector<MoveInternal> generate_moves(int x, int y, int dx, int dy, int distance, int piecesUsed) {
-		std::vector<MoveInternal> result;
+	template<int N>
+	std::vector<MoveInternalT<N>> generate_moves(int x, int y, int dx, int dy, int distance, int piecesUsed) {
+		std::vector<MoveInternalT<N>> result;
 
-		int d = dx + dy * Board::SIZE;
+		int d = dx + dy * N;
 		std::vector<std::vector<int>> vectors;
 		target_sum(piecesUsed, std::vector<int>(), vectors);
 
@@ -172,12 +30,13 @@ namespace movegen {
 
 		for (std::vector<int>& vec : vectors) {
 			if (vec.size() > (size_t)distance) continue;
-			MoveInternal move;
-			move.position = x + y * Board::SIZE;
+			MoveInternalT<N> move;
+			move.position = x + y * N;
 			move.split_count = vec.size();
 			for (int i : range(0, vec.size())) {
 				move.split_positions[i] = move.position + d * (i + 1);
 				move.split_sizes[i] = vec[i];
+				move.landing_mask |= 1ull << move.split_positions[i];
 			}
 			result.push_back(move);
 		}
@@ -185,135 +44,287 @@ namespace movegen {
 		return result;
 	}
 
-	struct _InitializeMoveCache {
-		void generate_cuts_for_position(int x, int y) {
-			const int directions[][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
-
-			for (const int* d : directions) {
-				int dx = d[0];
-				int dy = d[1];
-				int maxrange = Board::SIZE;
-
-				if (dx < 0)
-					maxrange = std::min(maxrange, x);
-				if (dx > 0)
-					maxrange = std::min(maxrange, Board::SIZE - x - 1);
-				if (dy < 0)
-					maxrange = std::min(maxrange, y);
-				if (dy > 0)
-					maxrange = std::min(maxrange, Board::SIZE - y - 1);
-
-				if (maxrange == 0) continue ;
-				for (int pieceCount : range(1, Board::SIZE + 1)) {
-					std::vector<MoveInternal> moves = generate_moves(x, y, dx, dy, std::min(maxrange, pieceCount), pieceCount);
-
-					// NOTE: adds normal moves
-					for (auto& move : moves) {
-						move.type = MoveInternal::TYPE_SPLIT;
-						move.moveid = all_moves.size();
-						all_moves.push_back(move);
-						cuts[INDEX_BOARD(x, y)][pieceCount].push_back(move);
-					}
+	template<int N>
+	static void generate_cuts_for_position(Tables<N>& tables, int x, int y) {
+		const int directions[][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+
+		for (const int* d : directions) {
+			int dx = d[0];
+			int dy = d[1];
+			int maxrange = N;
+
+			if (dx < 0)
+				maxrange = std::min(maxrange, x);
+			if (dx > 0)
+				maxrange = std::min(maxrange, N - x - 1);
+			if (dy < 0)
+				maxrange = std::min(maxrange, y);
+			if (dy > 0)
+				maxrange = std::min(maxrange, N - y - 1);
+
+			if (maxrange == 0) continue ;
+			for (int pieceCount : range(1, N + 1)) {
+				std::vector<MoveInternalT<N>> moves = generate_moves<N>(x, y, dx, dy, std::min(maxrange, pieceCount), pieceCount);
+
+				// NOTE: adds normal moves
+				for (auto& move : moves) {
+					move.type = MoveInternalT<N>::TYPE_SPLIT;
+					move.moveid = tables.all_moves.size();
+					tables.all_moves.push_back(move);
+					tables.cuts[x + y * N][pieceCount].push_back(move);
+				}
 
-					// NOTE: adds flatten moves
-					for (auto& move : moves) {
-						if (move.split_sizes[move.split_count - 1] != 1) continue ;
-						move.type = MoveInternal::TYPE_SPLIT_SQUASH;
-						move.moveid = all_moves.size();
-						all_moves.push_back(move);
-						cuts_flatten[INDEX_BOARD(x, y)][pieceCount].push_back(move);
-					}
+				// NOTE: adds flatten moves
+				for (auto& move : moves) {
+					if (move.split_sizes[move.split_count - 1] != 1) continue ;
+					move.type = MoveInternalT<N>::TYPE_SPLIT_SQUASH;
+					move.landing_mask &= ~(1ull << move.split_positions[move.split_count - 1]);
+					move.moveid = tables.all_moves.size();
+					tables.all_moves.push_back(move);
+					tables.cuts_flatten[x + y * N][pieceCount].push_back(move);
 				}
 			}
 		}
+	}
 
-		void generate_placements_for_position(int x, int y) {
-			int i = x + y * Board::SIZE;
-
-			MoveInternal move;
-
-			move.type = MoveInternal::TYPE_PLACE;
-			move.position = i;
+	template<int N>
+	static void generate_placements_for_position(Tables<N>& tables, int x, int y) {
+		int i = x + y * N;
 
-			move.piece = PIECE_FLAT;
-			move.moveid = all_moves.size();
-			all_moves.push_back(move);
-			placements[i][0] = move;
+		MoveInternalT<N> move;
 
-			move.piece = PIECE_WALL;
-			move.moveid = all_moves.size();
-			all_moves.push_back(move);
-			placements[i][1] = move;
+		move.type = MoveInternalT<N>::TYPE_PLACE;
+		move.position = i;
 
-			move.piece = PIECE_CAP;
-			move.moveid = all_moves.size();
-			all_moves.push_back(move);
-			placements[i][2] = move;
+		const int8_t pieces[] = {PIECE_FLAT, PIECE_WALL, PIECE_CAP};
+		for (int j = 0; j < 3; ++j) {
+			move.piece = pieces[j];
+			move.moveid = tables.all_moves.size();
+			tables.all_moves.push_back(move);
+			tables.placements[i][j] = move;
 		}
+	}
 
-		void generate_moves_for_position(int x, int y) {
-			generate_placements_for_position(x, y);
-			generate_cuts_for_position(x, y);
+	// the number of ways to drop n pieces on exactly the given number of squares
+	static int compositions(int n, int squares) {
+		if (n == 0 || squares == 0) return n == squares;
+		int count = 0;
+		for (int first = 1; first <= n; ++first)
+			count += compositions(n - first, squares - 1);
+		return count;
+	}
+
+	template<int N>
+	Tables<N>::Tables() {
+		for (int y : range(0, N)) {
+			for (int x : range(0, N)) {
+				generate_placements_for_position(*this, x, y);
+				generate_cuts_for_position(*this, x, y);
+			}
 		}
 
-		_InitializeMoveCache() {
-			for (int y : range(0, Board::SIZE)) {
-				for (int x : range(0, Board::SIZE)) {
-					generate_moves_for_position(x, y);
+		// NOTE: a squash drops all but its last piece on every free square before the wall
+		for (int limit = 0; limit <= N; ++limit) {
+			for (int free = 0; free < N; ++free) {
+				spread_counts[limit][free] = 0;
+				squash_counts[limit][free] = 0;
+				for (int carry = 1; carry <= limit; ++carry) {
+					for (int squares = 1; squares <= free; ++squares)
+						spread_counts[limit][free] += compositions(carry, squares);
+					squash_counts[limit][free] += compositions(carry - 1, free);
 				}
 			}
 		}
-	};
-
-	_InitializeMoveCache _movecache;
+	}
 
+	// NOTE: defined in one translation unit so they are built in order, before anything below can use them
+	static Tables<3> tables3;
+	static Tables<4> tables4;
+	static Tables<5> tables5;
+	static Tables<6> tables6;
+	static Tables<7> tables7;
+	static Tables<8> tables8;
+
+	template<> const Tables<3>& tables<3>() { return tables3; }
+	template<> const Tables<4>& tables<4>() { return tables4; }
+	template<> const Tables<5>& tables<5>() { return tables5; }
+	template<> const Tables<6>& tables<6>() { return tables6; }
+	template<> const Tables<7>& tables<7>() { return tables7; }
+	template<> const Tables<8>& tables<8>() { return tables8; }
+
+	const std::vector<MoveInternal>& all_moves = tables5.all_moves;
+	const MoveInternal (&placements)[Board::SQUARES][3] = tables5.placements;
+	const std::vector<MoveInternal> (&cuts)[Board::SQUARES][Board::SIZE + 1] = tables5.cuts;
+	const std::vector<MoveInternal> (&cuts_flatten)[Board::SQUARES][Board::SIZE + 1] = tables5.cuts_flatten;
 }
 
 
-std::vector<Move> Board::get_moves(int8_t team) const {
-	uint64_t boardhash = this->hash();
-
-	std::vector<Move> moves;
-	for (int i = 0; i < Board::SQUARES; ++i) {
-		const Stack& stack = stacks[i];
-		int8_t top = stack.top();
-
-		if (top == 0) {
-			// NOTE: these moves are for the top of the stack
-			for (int j = 0; j < 3; ++j) {
-				MoveInternal& move = movegen::placements[i][j];
-				if (move.can_move(*this))
-					moves.push_back(Move(boardhash, move.moveid));
+namespace movegen {
+	/**
+		the legal moves of one kind of position. the side whose stacks move, the opening phase and the reserves left to
+		place are template arguments so the loop over the squares makes no decisions about them
+	*/
+	template<int N, int TEAM, bool OPENING, bool CAPSTONE, bool FLATS>
+	static void generate(const BoardT<N>& board, std::vector<Move>& moves) {
+		const Tables<N>& tables = movegen::tables<N>();
+		const uint64_t boardhash = board.hash();
+
+		// NOTE: spreads only have to look up the squares they drop on in these
+		uint64_t blocked = 0;
+		uint64_t walls = 0;
+		if (!OPENING) {
+			for (int i = 0; i < N * N; ++i) {
+				const int8_t top = board.stacks[i].top();
+				blocked |= (uint64_t)(top >= PIECE_WALL || top <= -PIECE_WALL) << i;
+				walls |= (uint64_t)(top == PIECE_WALL || top == -PIECE_WALL) << i;
 			}
-		} else if (top * team > 0 && moveno >= 2) {
-			bool stop = false;
-			int limit = 5 < stack.size() ? 5 : stack.size();
-			for (int j = 1; j <= limit && !stop; ++j) {
-				for (MoveInternal& move : movegen::cuts[i][j]) {
-					if (move.can_move(*this))
-						moves.push_back(Move(boardhash, move.moveid));
+		}
+
+		for (int i = 0; i < N * N; ++i) {
+			const typename BoardT<N>::Stack& stack = board.stacks[i];
+			const int8_t top = stack.top();
+
+			if (top == 0) {
+				if (FLATS) {
+					moves.push_back(Move(boardhash, tables.placements[i][0].moveid));
+					if (!OPENING) moves.push_back(Move(boardhash, tables.placements[i][1].moveid));
 				}
-				if (top * team == PIECE_CAP) {
-					for (MoveInternal& move : movegen::cuts_flatten[i][j]) {
-						if (move.can_move(*this))
+				if (CAPSTONE) moves.push_back(Move(boardhash, tables.placements[i][2].moveid));
+			} else if (!OPENING && top * TEAM > 0) {
+				// NOTE: the carry limit is the size of the board
+				const int limit = N < stack.size() ? N : stack.size();
+				for (int j = 1; j <= limit; ++j) {
+					for (const MoveInternalT<N>& move : tables.cuts[i][j]) {
+						if ((move.landing_mask & blocked) == 0)
 							moves.push_back(Move(boardhash, move.moveid));
 					}
+					if (top == TEAM * PIECE_CAP) {
+						for (const MoveInternalT<N>& move : tables.cuts_flatten[i][j]) {
+							if ((move.landing_mask & blocked) == 0 && (walls >> move.split_positions[move.split_count - 1]) & 1)
+								moves.push_back(Move(boardhash, move.moveid));
+						}
+					}
 				}
 			}
 		}
 	}
 
+	template<int N, int TEAM>
+	static void generateForTeam(const BoardT<N>& board, std::vector<Move>& moves) {
+		// NOTE: the first two plies place a flat of the opponent's and nothing else
+		if (board.moveno < 2) {
+			generate<N, TEAM, true, false, true>(board, moves);
+			return ;
+		}
+
+		const int placer = board.placementColor() > 0 ? 0 : 1;
+		const bool capstone = board.capstones[placer] > 0;
+		const bool flats = board.piecesleft[placer] > 0;
+		if (capstone && flats) generate<N, TEAM, false, true, true>(board, moves);
+		else if (capstone) generate<N, TEAM, false, true, false>(board, moves);
+		else if (flats) generate<N, TEAM, false, false, true>(board, moves);
+		else generate<N, TEAM, false, false, false>(board, moves);
+	}
+}
+
+template<int N>
+std::vector<Move> BoardT<N>::get_moves(int8_t team) const {
+	std::vector<Move> moves;
+	if (team > 0) movegen::generateForTeam<N, 1>(*this, moves);
+	else movegen::generateForTeam<N, -1>(*this, moves);
 	return moves;
 };
 
-void Move::apply(Board& board) const {
-	movegen::all_moves[moveid].apply(board);
+template<int N>
+int BoardT<N>::count_moves(int8_t team) const {
+	int empty = 0;
+	for (int i = 0; i < SQUARES; ++i)
+		empty += stacks[i].top() == 0;
+
+	// NOTE: the first two plies place a flat of the opponent's and nothing else
+	if (moveno < 2) return empty;
+
+	const int placer = placementColor() > 0 ? 0 : 1;
+	const int kinds = (piecesleft[placer] > 0) * 2 + (capstones[placer] > 0);
+	return empty * kinds + count_spreads(team);
+}
+
+template<int N>
+int BoardT<N>::count_spreads(int8_t team) const {
+	if (moveno < 2) return 0;
+
+	const movegen::Tables<N>& tables = movegen::tables<N>();
+	const int directions[][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+	int count = 0;
+	for (int i = 0; i < SQUARES; ++i) {
+		const int8_t top = stacks[i].top();
+		if (top * team <= 0) continue;
+
+		const int limit = N < stacks[i].size() ? N : stacks[i].size();
+		for (const int* d : directions) {
+			int free = 0;
+			int8_t blocker = 0;
+			for (int x = i % N + d[0], y = i / N + d[1]; x >= 0 && x < N && y >= 0 && y < N; x += d[0], y += d[1]) {
+				const int8_t landing = stacks[x + y * N].top();
+				if (landing >= PIECE_WALL || landing <= -PIECE_WALL) {
+					blocker = landing;
+					break;
+				}
+				free++;
+			}
+
+			count += tables.spread_counts[limit][free];
+			if (top == team * PIECE_CAP && (blocker == PIECE_WALL || blocker == -PIECE_WALL))
+				count += tables.squash_counts[limit][free];
+		}
+	}
+	return count;
 }
 
-void Move::revert(Board& board) const {
-	movegen::all_moves[moveid].revert(board);
+namespace movegen {
+	template<int N>
+	uint64_t perft(BoardT<N>& board, int depth) {
+		if (depth == 0) return 1;
+		if (board.getWinner() != 0) return 0;
+		if (depth == 1) return board.count_moves();
+
+		uint64_t nodes = 0;
+		for (const Move& move : board.get_moves()) {
+			move.apply(board);
+			nodes += perft(board, depth - 1);
+			move.revert(board);
+		}
+		return nodes;
+	}
 }
 
+template<int N>
+void Move::apply(BoardT<N>& board) const {
+	movegen::tables<N>().all_moves[moveid].apply(board);
+}
+
+template<int N>
+void Move::revert(BoardT<N>& board) const {
+	movegen::tables<N>().all_moves[moveid].revert(board);
+}
+
+template<int N>
 std::string Move::toString() const {
-	return movegen::all_moves[moveid].toString();
+	return movegen::tables<N>().all_moves[moveid].toString();
 }
+
+#define INSTANTIATE_MOVEGEN(N) \
+	template std::vector<Move> BoardT<N>::get_moves(int8_t team) const; \
+	template int BoardT<N>::count_moves(int8_t team) const; \
+	template int BoardT<N>::count_spreads(int8_t team) const; \
+	template uint64_t movegen::perft<N>(BoardT<N>& board, int depth); \
+	template void Move::apply<N>(BoardT<N>& board) const; \
+	template void Move::revert<N>(BoardT<N>& board) const; \
+	template std::string Move::toString<N>() const;
+
+INSTANTIATE_MOVEGEN(3)
+INSTANTIATE_MOVEGEN(4)
+INSTANTIATE_MOVEGEN(5)
+INSTANTIATE_MOVEGEN(6)
+INSTANTIATE_MOVEGEN(7)
+INSTANTIATE_MOVEGEN(8)
@@ -0,0 +1,184 @@
+#ifndef __MOVEGEN_H_
+#define __MOVEGEN_H_
+
+#include <string>
+#include <sstream>
+#include <vector>
+
+#include "board.h"
+
+/**
+	move generation, the tables of every move are built once per board size
+*/
+
+template<int N>
+struct MoveInternalT {
+	const static int8_t TYPE_PLACE = 1;
+	const static int8_t TYPE_SPLIT = 2;
+	const static int8_t TYPE_SPLIT_SQUASH = 3;
+
+	MoveInternalT() { bzero(this, sizeof(MoveInternalT)); };
+
+	uint32_t moveid;
+
+	int8_t type = 0;
+
+	int8_t position;
+	int8_t piece;
+
+	int8_t split_count;
+	int8_t split_positions[N];
+	int8_t split_sizes[N];
+
+	// squares a spread drops on that must not hold a wall or capstone, all but the last one for a squash
+	uint64_t landing_mask;
+
+	std::string toString() const {
+		std::stringstream ss;
+
+		if (type == TYPE_PLACE) {
+			ss << "place " << (char)('A' + position % N) << (int) 1 + position / N << piece_to_string(piece) << std::endl;
+		} else if (type == TYPE_SPLIT || type == TYPE_SPLIT_SQUASH) {
+			if (type == TYPE_SPLIT_SQUASH) {
+				ss << "ITS A SQUASHER!" << std::endl;
+			}
+
+			ss << "split " << (char)('A' + position % N) << (int) 1 + position / N << std::endl;
+			for (int i = 0; i < split_count; ++i) {
+				int position = split_positions[i];
+				ss << "\t#" << (int) split_sizes[i] << " - " << (char)('A' + position % N) << (int) 1 + position / N << std::endl;
+			}
+		}
+
+		return ss.str();
+	}
+
+	inline static int8_t piece_color(const BoardT<N>& board) {
+		return board.placementColor();
+	}
+
+	bool can_move(const BoardT<N>& board) const {
+		if (type == TYPE_PLACE) {
+			int8_t piece = this->piece * MoveInternalT::piece_color(board);
+			if (board.moveno < 2) return piece == PIECE_FLAT || piece == -PIECE_FLAT;
+			switch (piece) {
+			case PIECE_CAP: return board.capstones[0] > 0;
+			case -PIECE_CAP: return board.capstones[1] > 0;
+			case PIECE_WALL:
+			case PIECE_FLAT: return board.piecesleft[0] > 0;
+			case -PIECE_WALL:
+			case -PIECE_FLAT: return board.piecesleft[1] > 0;
+			default:
+				exit(0);
+			}
+		} else if(type == TYPE_SPLIT) {
+			for (int i = 0; i < split_count; ++i) {
+				const int8_t landingOn = board.stacks[split_positions[i]].top();
+				if (landingOn == PIECE_WALL || landingOn == -PIECE_WALL || landingOn == PIECE_CAP || landingOn == -PIECE_CAP) return false;
+			}
+			return true;
+		} else if (type == TYPE_SPLIT_SQUASH) {
+			for (int i = 0; i < split_count - 1; ++i) {
+				const int8_t landingOn = board.stacks[split_positions[i]].top();
+				if (landingOn == PIECE_WALL || landingOn == -PIECE_WALL || landingOn == PIECE_CAP || landingOn == -PIECE_CAP) return false;
+			}
+			int8_t top = board.stacks[split_positions[split_count - 1]].top();
+			return top == PIECE_WALL || top == -PIECE_WALL;
+		}
+		return false;
+	}
+
+	void apply(BoardT<N>& board) const {
+		assert(type != 0);
+		const int8_t piece_color = MoveInternalT::piece_color(board);
+		board.playerTurn = -board.playerTurn;
+		board.moveno++;
+		if (type == TYPE_PLACE) {
+			board.place(position, piece * piece_color);
+			switch (piece * piece_color) {
+			case PIECE_CAP: board.capstones[0]--; break ;
+			case -PIECE_CAP: board.capstones[1]--; break ;
+			case PIECE_FLAT:
+			case PIECE_WALL: board.piecesleft[0]--; break ;
+			case -PIECE_FLAT:
+			case -PIECE_WALL: board.piecesleft[1]--; break ;
+			}
+			return ;
+		}
+
+		for (int8_t i = split_count - 1; i >= 0; --i) {
+			board.move(position, split_positions[i], split_sizes[i]);
+		}
+	}
+
+	void revert(BoardT<N>& board) const {
+		assert(type != 0);
+		board.moveno--;
+		board.playerTurn = -board.playerTurn;
+		const int8_t piece_color = MoveInternalT::piece_color(board);
+		if (type == TYPE_PLACE) {
+			board.remove(position);
+			switch (piece * piece_color) {
+			case PIECE_CAP: board.capstones[0]++; break ;
+			case -PIECE_CAP: board.capstones[1]++; break ;
+			case PIECE_FLAT:
+			case PIECE_WALL: board.piecesleft[0]++; break ;
+			case -PIECE_FLAT:
+			case -PIECE_WALL: board.piecesleft[1]++; break ;
+			}
+			return ;
+		}
+
+		for (int8_t i = 0; i < split_count; ++i) {
+			board.move(split_positions[i], position, split_sizes[i]);
+		}
+
+		if (type == TYPE_SPLIT_SQUASH) {
+			board.remove(position);
+			board.place(position, PIECE_CAP * piece_color);
+
+			const int8_t last = split_positions[split_count - 1];
+			const int8_t wall = board.stacks[last].top() > 0 ? PIECE_WALL : -PIECE_WALL;
+			board.remove(last);
+			board.place(last, wall);
+		}
+	}
+};
+
+typedef MoveInternalT<5> MoveInternal;
+
+namespace movegen {
+	template<int N>
+	struct Tables {
+		// every move that can be made on the board, indexed by Move::moveid
+		std::vector<MoveInternalT<N>> all_moves;
+
+		// placements[square][piece - 1]
+		MoveInternalT<N> placements[N * N][3];
+
+		// spreads by origin square and number of pieces carried, 0 isn't used
+		std::vector<MoveInternalT<N>> cuts[N * N][N + 1];
+		std::vector<MoveInternalT<N>> cuts_flatten[N * N][N + 1];
+
+		// the number of spreads by carry limit and the free squares in their direction, for count_moves
+		int spread_counts[N + 1][N];
+		// the same for squashes, when the first blocked square holds a wall
+		int squash_counts[N + 1][N];
+
+		Tables();
+	};
+
+	// built during static initialization for every supported size
+	template<int N> const Tables<N>& tables();
+
+	// leaf nodes of the game tree at the depth, decided games are not played on. the last ply is only counted
+	template<int N> uint64_t perft(BoardT<N>& board, int depth);
+
+	// the 5x5 tables
+	extern const std::vector<MoveInternal>& all_moves;
+	extern const MoveInternal (&placements)[Board::SQUARES][3];
+	extern const std::vector<MoveInternal> (&cuts)[Board::SQUARES][Board::SIZE + 1];
+	extern const std::vector<MoveInternal> (&cuts_flatten)[Board::SQUARES][Board::SIZE + 1];
+}
+
+#endif
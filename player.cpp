@@ -0,0 +1,134 @@
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include "player.h"
+#include "book.h"
+#include "endgame.h"
+#include "eval.h"
+#include "movegen.h"
+#include "tablebase.h"
+
+static std::vector<std::string> split(const std::string& str, char delimiter) {
+	std::vector<std::string> parts;
+	std::string part;
+	std::istringstream ss(str);
+	while (std::getline(ss, part, delimiter))
+		parts.push_back(part);
+	return parts;
+}
+
+static bool configureMCTS(MCTSPlayer* player, const std::string& option) {
+	size_t eq = option.find('=');
+	std::string name = option.substr(0, eq);
+	std::string value = eq == std::string::npos ? "" : option.substr(eq + 1);
+
+	try {
+		if (name == "tt") player->transpositions = true;
+		else if (name == "solver") player->solver = true;
+		else if (name == "puct") player->puct = true;
+		else if (name == "sym") player->symmetry = true;
+		else if (name == "threats") player->threatCutoff = true;
+		else if (name == "cutoff") player->playoutCutoff = std::stoi(value);
+		else if (name == "nodes") player->maxNodes = std::stoul(value);
+		else if (name == "history") player->historyWeight = std::stof(value);
+		else if (name == "rave") player->raveK = std::stof(value);
+		else return false;
+	} catch (const std::exception& e) {
+		return false;
+	}
+	return true;
+}
+
+static bool configureMinmax(MinmaxPlayer* player, const std::string& option) {
+	size_t eq = option.find('=');
+	std::string name = option.substr(0, eq);
+	std::string value = eq == std::string::npos ? "" : option.substr(eq + 1);
+
+	try {
+		if (name == "sym") player->symmetry = true;
+		else if (name == "mobility") player->mobility = std::stod(value);
+		else if (name == "proof") player->proofNodes = std::stoul(value);
+		else if (name == "threats") player->threatDepth = std::stoi(value);
+		else if (name == "endgame") player->endgameThreshold = value.empty() ? endgame::DEFAULT_RESERVE_THRESHOLD : std::stoi(value);
+		else if (name == "weights") return eval::loadWeights(value, player->weights.data());
+		else return false;
+	} catch (const std::exception& e) {
+		return false;
+	}
+	return true;
+}
+
+bool Player::playBookMove(Board& board) {
+	uint32_t moveid;
+	if (book && book->probe(board, &moveid)) {
+		if (verbose) std::cout << "book move: " << movegen::all_moves[moveid].toString() << std::endl;
+	} else if (book::openingPlacement(board, &moveid)) {
+		if (verbose) std::cout << "opening placement: " << movegen::all_moves[moveid].toString() << std::endl;
+	} else {
+		return false;
+	}
+	movegen::all_moves[moveid].apply(board);
+	return true;
+}
+
+template<int N>
+bool Player::playTablebaseMove(BoardT<N>& board) {
+	Move move;
+	tablebase::Probe probe;
+	if (!tablebase || !tablebase->bestMove(board, &move, &probe)) return false;
+
+	if (verbose) {
+		std::cout << "tablebase " << tablebase::resultString(probe.result) << " in " << probe.distance
+			<< " plies, move: " << move.toString<N>() << std::endl;
+	}
+	move.apply(board);
+	return true;
+}
+
+#define INSTANTIATE_PLAYER(N) \
+	template bool Player::playTablebaseMove<N>(BoardT<N>& board);
+
+INSTANTIATE_PLAYER(3)
+INSTANTIATE_PLAYER(4)
+INSTANTIATE_PLAYER(5)
+INSTANTIATE_PLAYER(6)
+INSTANTIATE_PLAYER(7)
+INSTANTIATE_PLAYER(8)
+
+Player* createPlayer(const std::string& spec) {
+	std::vector<std::string> parts = split(spec, ':');
+	if (parts.empty()) return nullptr;
+
+	try {
+		if (parts[0] == "human") {
+			return new HumanPlayer();
+		} else if (parts[0] == "minmax") {
+			MinmaxPlayer* player = new MinmaxPlayer(parts.size() > 1 ? std::stoi(parts[1]) : 4);
+			if (parts.size() > 2) {
+				for (const std::string& option : split(parts[2], ',')) {
+					if (!configureMinmax(player, option)) {
+						delete player;
+						return nullptr;
+					}
+				}
+			}
+			return player;
+		} else if (parts[0] == "mcts") {
+			MCTSPlayer* player = new MCTSPlayer(parts.size() > 1 ? std::stoi(parts[1]) : 1000);
+			if (parts.size() > 2) {
+				for (const std::string& option : split(parts[2], ',')) {
+					if (!configureMCTS(player, option)) {
+						delete player;
+						return nullptr;
+					}
+				}
+			}
+			return player;
+		}
+	} catch (const std::exception& e) {
+		// NOTE: std::stoi and friends throw on malformed numbers
+	}
+	return nullptr;
+}
@@ -1,10 +1,32 @@
 #ifndef __PLAYER_H_
 #define __PLAYER_H_
 
+#include <string>
+#include <vector>
+
 #include "board.h"
 
+namespace book { class Book; }
+namespace tablebase { class Table; }
+
 struct Player {
+	// print the reasoning behind every move to stdout
+	bool verbose = true;
+
+	// opening book shared between players, not owned
+	const book::Book* book = nullptr;
+
+	// tablebase shared between players, not owned. the searches take positions found in it as decided
+	const tablebase::Table* tablebase = nullptr;
+
 	virtual Board makeAMove(Board board) = 0;
+	virtual ~Player() { };
+
+	// plays a book move or a corner placement on the first plies without searching, returns false if there is none
+	bool playBookMove(Board& board);
+
+	// plays the tablebase move if the position is in the table, returns false if it is not
+	template<int N> bool playTablebaseMove(BoardT<N>& board);
 };
 
 struct HumanPlayer : public Player {
@@ -17,12 +39,57 @@ struct MinmaxPlayer : public Player {
 	constexpr static double MAX_SCORE = 100000000.0;
 	constexpr static double WIN_SCORE = MAX_SCORE / 100.0;
 
-	MinmaxPlayer(int depth) : depth(depth) { };
+	// search only one move out of each set that leads to symmetric positions at the root
+	bool symmetry = false;
+
+	// score per spread white can make more than black, 0 leaves mobility out of the evaluation
+	double mobility = 0.0;
+
+	// nodes of proof number search for a forced win before searching the move, 0 to skip it
+	unsigned long proofNodes = 0;
+
+	// threats the threat space search at the leaves may make before its winning move, -1 to skip it. also puts
+	// forcing moves first
+	int threatDepth = -1;
+
+	// reserve at which the endgame solver takes over when it can prove the result, 0 to never use it
+	int endgameThreshold = 0;
+
+	// evaluation weights indexed by eval::Weight, the ones loaded at startup unless the player is given a file
+	std::vector<double> weights;
+
+	MinmaxPlayer(int depth);
+
+	virtual Board makeAMove(Board board);
+
+	// the tablebase move or the best move of the search on a board of any size. the book, proof and endgame moves
+	// of makeAMove are 5x5 only, so are the threat search and symmetry pruning
+	template<int N> BoardT<N> searchMove(BoardT<N> board);
+
+	template<int N> double minmax(BoardT<N>& board, int depth, Move* result, double alpha = -MAX_SCORE, double beta = MAX_SCORE);
+	template<int N> double scoreBoard(const BoardT<N>& board);
+	template<int N> double scoreMaterial(const BoardT<N>& board);
+};
+
+struct MCTSPlayer : public Player {
+	int timeMs;
+	bool transpositions = false;
+	float historyWeight = 0.0;
+	float raveK = 0.0;
+	int playoutCutoff = 0;
+	bool threatCutoff = false;
+	bool solver = false;
+	unsigned long maxNodes = 0;
+	bool puct = false;
+	bool symmetry = false;
+
+	MCTSPlayer(int timeMs) : timeMs(timeMs) { };
 
 	virtual Board makeAMove(Board board);
-	double minmax(Board& board, int depth, Move* result, double alpha = -MAX_SCORE, double beta = MAX_SCORE);
-	double scoreBoard(const Board& board);
-	double scoreMaterial(const Board& board);
 };
 
+// creates a player from a spec such as "human", "minmax:4:sym" or "mcts:1000:puct,solver,cutoff=12"
+// returns nullptr if the spec is invalid
+Player* createPlayer(const std::string& spec);
+
 #endif
@@ -0,0 +1,209 @@
+#include <algorithm>
+#include <iostream>
+
+#include "player.h"
+#include "playout.h"
+#include "eval.h"
+#include "policy.h"
+#include "symmetry.h"
+#include "tablebase.h"
+
+// NOTE: the history tables are flat arrays indexed by TakAction::id(), cheap enough to always compile in
+#define PROG_HIST
+#define RAVE
+#include "mcts.h"
+
+/**
+	bindings of the generic MCTS framework to the Tak board
+*/
+
+class TakState : public State {
+public:
+	Board board;
+
+	// playouts stop after this many plies and are scored by the evaluation, 0 plays to the end of the game
+	int playoutCutoff = 0;
+	// playouts stop as soon as a road threat decides the game
+	bool threatCutoff = false;
+	// expand moves in the order of the policy priors instead of randomly
+	bool usePriors = false;
+	// share transpositions between mirrored and rotated positions, and expand one move out of each symmetric set
+	bool symmetric = false;
+	// positions in the tablebase end the search like the end of the game, not owned
+	const tablebase::Table* tablebase = nullptr;
+
+	TakState(const Board& board) : board(board) { };
+
+	virtual uint64_t hash() override {
+		return symmetric ? symmetry::canonicalHash(board) : board.hash();
+	}
+
+protected:
+	virtual void print(std::ostream& strm) override {
+		strm << board;
+	}
+};
+
+class TakAction : public Action<TakState> {
+public:
+	Move move;
+	int8_t player = 0;
+
+	TakAction() { };
+	TakAction(const Move& move, int8_t player) : move(move), player(player) { };
+
+	virtual void execute(TakState* state) override {
+		move.apply(state->board);
+	}
+
+	// NOTE: history is shared between positions, so only the move and who makes it identify an action
+	unsigned int id() const {
+		return move.moveid * 2 + (player > 0 ? 1 : 0);
+	}
+
+protected:
+	virtual void print(std::ostream& strm) override {
+		strm << move.toString();
+	}
+};
+
+class TakExpansion : public ExpansionStrategy<TakState, TakAction> {
+	std::vector<Move> moves;
+	std::vector<float> priors;
+	size_t next = 0;
+public:
+	TakExpansion(TakState* state) : ExpansionStrategy<TakState, TakAction>(state), moves(state->board.get_moves()) {
+		if (state->symmetric)
+			symmetry::pruneSymmetricMoves(state->board, &moves);
+
+		if (!state->usePriors) {
+			std::random_shuffle(moves.begin(), moves.end());
+			return ;
+		}
+
+		// sort the moves by descending prior, through an index so the two vectors stay in step
+		std::vector<float> unsorted;
+		policy::priors(state->board, moves, unsorted);
+		std::vector<size_t> order(moves.size());
+		for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+		std::sort(order.begin(), order.end(), [&unsorted](size_t a, size_t b) {
+			return unsorted[a] > unsorted[b];
+		});
+
+		std::vector<Move> sorted;
+		sorted.reserve(moves.size());
+		priors.reserve(moves.size());
+		for (size_t i : order) {
+			sorted.push_back(moves[i]);
+			priors.push_back(unsorted[i]);
+		}
+		moves.swap(sorted);
+	}
+
+	virtual float nextPrior() override {
+		return priors.empty() ? 1 : priors[next];
+	}
+
+	virtual TakAction* generateNext() override {
+		return new TakAction(moves[next++], state->board.playerTurn);
+	}
+
+	virtual bool canGenerateNext() override {
+		return next < moves.size();
+	}
+};
+
+class TakPlayout : public PlayoutStrategy<TakState, TakAction> {
+public:
+	TakPlayout(TakState* state) : PlayoutStrategy<TakState, TakAction>(state) { };
+
+	virtual void generateRandom(TakAction* action) override {
+		std::vector<Move> moves = state->board.get_moves();
+		action->move = moves[rand() % moves.size()];
+		action->player = state->board.playerTurn;
+	}
+
+	virtual bool playout(std::vector<unsigned int>* actions) override {
+		const size_t first = actions ? actions->size() : 0;
+		int8_t player = state->board.playerTurn;
+
+		if (state->playoutCutoff > 0)
+			playout::play(state->board, actions, state->playoutCutoff, state->threatCutoff);
+		else
+			playout::play(state->board, actions, playout::MAX_PLIES, state->threatCutoff);
+
+		// turn the move ids into TakAction ids, the players alternate from the one to move at the start
+		if (actions) {
+			for (size_t i = first; i < actions->size(); ++i) {
+				(*actions)[i] = (*actions)[i] * 2 + (player > 0 ? 1 : 0);
+				player = -player;
+			}
+		}
+		return true;
+	}
+};
+
+// scores are from white's point of view, each node is scored for the player who moved into it
+class TakBackpropagation : public Backpropagation<TakState> {
+public:
+	virtual float updateScore(TakState* state, float backpropScore) override {
+		return state->board.playerTurn > 0 ? 1 - backpropScore : backpropScore;
+	}
+};
+
+class TakTerminationCheck : public TerminationCheck<TakState> {
+public:
+	virtual bool isTerminal(TakState* state) override {
+		if (state->board.getWinner() != 0) return true;
+		return state->tablebase && state->tablebase->probe(state->board).result != tablebase::UNKNOWN;
+	}
+};
+
+// playouts can stop before the end of the game, those states are scored by the evaluation
+class TakScoring : public Scoring<TakState> {
+public:
+	virtual float score(TakState* state) override {
+		int winner = state->board.getWinner();
+		if (winner == 0 && state->tablebase) {
+			const tablebase::Probe probe = state->tablebase->probe(state->board);
+			if (probe.result == tablebase::DRAW) return 0.5;
+			if (probe.result == tablebase::WIN) winner = state->board.playerTurn;
+			if (probe.result == tablebase::LOSS) winner = -state->board.playerTurn;
+		}
+		if (winner == 0 && state->threatCutoff)
+			winner = playout::decidedByThreats(state->board);
+		if (winner == 0) return eval::winProbability(state->board);
+		return winner > 0 ? 1 : 0;
+	}
+};
+
+Board MCTSPlayer::makeAMove(Board board) {
+	if (playBookMove(board) || playTablebaseMove(board)) return board;
+
+	TakState* root = new TakState(board);
+	root->playoutCutoff = playoutCutoff;
+	root->threatCutoff = threatCutoff;
+	root->usePriors = puct;
+	root->symmetric = symmetry;
+	root->tablebase = tablebase;
+
+	MCTS<TakState, TakAction, TakExpansion, TakPlayout> mcts(root,
+		new TakBackpropagation(), new TakTerminationCheck(), new TakScoring());
+	mcts.setTime(timeMs);
+	mcts.setTranspositions(transpositions);
+	mcts.setW(historyWeight);
+	mcts.setRaveK(raveK);
+	mcts.setSolver(solver);
+	mcts.setMaxNodes(maxNodes);
+	mcts.setPuct(puct);
+
+	TakAction* action = mcts.calculateAction();
+	action->move.apply(board);
+	if (verbose) {
+		std::cout << "MCTS Player generated move: " << action->move.toString() << std::endl;
+		if (mcts.getRoot()->getProven() != 0)
+			std::cout << "\tproven " << (mcts.getRoot()->getProven() < 0 ? "win" : "loss") << std::endl;
+	}
+	delete action;
+	return board;
+}
@@ -2,21 +2,62 @@
 #include <iostream>
 
 #include "player.h"
+#include "eval.h"
+#include "symmetry.h"
+#include "proof.h"
+#include "threats.h"
+#include "endgame.h"
+#include "tablebase.h"
 
 
-int cutoffs = 0;
-double MinmaxPlayer::minmax(Board& board, int depth, Move* result, double alpha, double beta) {
+MinmaxPlayer::MinmaxPlayer(int depth) : depth(depth), weights(eval::weights, eval::weights + eval::WEIGHT_COUNT) { }
+
+// NOTE: the threat search and symmetry pruning only know 5x5 boards, the search goes without them on other sizes
+template<int N> static bool forcedRoad(BoardT<N>& /*board*/, int /*depth*/) { return false; }
+static bool forcedRoad(Board& board, int depth) { return threats::search(board, depth); }
+
+template<int N> static void pruneSymmetricMoves(const BoardT<N>& /*board*/, std::vector<Move>* /*moves*/) { }
+static void pruneSymmetricMoves(const Board& board, std::vector<Move>* moves) { symmetry::pruneSymmetricMoves(board, moves); }
+
+template<int N> static void orderMoves(BoardT<N>& /*board*/, std::vector<Move>* /*moves*/) { }
+static void orderMoves(Board& board, std::vector<Move>* moves) { threats::orderMoves(board, moves); }
+
+thread_local int cutoffs = 0;
+template<int N>
+double MinmaxPlayer::minmax(BoardT<N>& board, int depth, Move* result, double alpha, double beta) {
 	int winner = board.getWinner();
 	if (winner != 0) return winner * WIN_SCORE;
-	if (depth == 0) return scoreBoard(board);
+	if (tablebase) {
+		// NOTE: a win further away scores a little less, like the forced roads below
+		const tablebase::Probe probe = tablebase->probe(board);
+		if (probe.result == tablebase::WIN) return board.playerTurn * (WIN_SCORE - probe.distance);
+		if (probe.result == tablebase::LOSS) return -board.playerTurn * (WIN_SCORE - probe.distance);
+		if (probe.result == tablebase::DRAW) return 0;
+	}
+	if (depth == 0) {
+		// NOTE: a forced road is worth less than one on the board so the search still prefers the shorter win
+		if (threatDepth >= 0 && forcedRoad(board, threatDepth))
+			return board.playerTurn * WIN_SCORE / 2;
+		return scoreBoard(board);
+	}
 
 	std::vector<Move> moves = board.get_moves();
+	// NOTE: a side without a move, a full board of walls on the small sizes, is a draw like in the tablebases
+	if (moves.empty()) return 0;
+	if (result && symmetry)
+		pruneSymmetricMoves(board, &moves);
+	if (threatDepth >= 0)
+		orderMoves(board, &moves);
+
+	// NOTE: ties at the root are broken at random, which only works between exact scores. a child cut off by the
+	// window returns a bound that can equal the best score, so at the root the window is kept one wider than it
+	const double slack = result ? 1 : 0;
 
 	if (board.playerTurn > 0) {
 		double max = -MAX_SCORE;
 		for (Move& move : moves) {
 			move.apply(board);
-			double score = this->minmax(board, depth - 1, nullptr, alpha, beta);
+			double score = this->minmax(board, depth - 1, nullptr, alpha - slack, beta);
 			move.revert(board);
 
 	        if (score > max || (score == max && rand() % 2 == 0)) {
@@ -36,7 +77,7 @@ double MinmaxPlayer::minmax(Board& board, int depth, Move* result, double alpha,
 		double min = MAX_SCORE;
 		for (Move& move : moves) {
 	        move.apply(board);
-	        double score = this->minmax(board, depth - 1, nullptr, alpha, beta);
+	        double score = this->minmax(board, depth - 1, nullptr, alpha, beta + slack);
 	        move.revert(board);
 
 	        if (score < min || (score == min && rand() % 2 == 0)) {
@@ -56,95 +97,71 @@ double MinmaxPlayer::minmax(Board& board, int depth, Move* result, double alpha,
 }
 
 Board MinmaxPlayer::makeAMove(Board board) {
+	if (playBookMove(board) || playTablebaseMove(board)) return board;
+
+	Move move;
+	if (proofNodes > 0) {
+		proof::Solver solver;
+		if (solver.findWin(board, proofNodes, &move)) {
+			move.apply(board);
+			if (verbose) std::cout << "proved a win in " << solver.nodes() << " nodes, move: " << move.toString() << std::endl;
+			return board;
+		}
+	}
+
+	if (endgameThreshold > 0 && endgame::applies(board, endgameThreshold)) {
+		endgame::Solver solver;
+		endgame::Result result = solver.solve(board);
+		if (result.exact) {
+			result.move.apply(board);
+			if (verbose) {
+				std::cout << "endgame solved in " << solver.nodes() << " nodes, " << (result.win() ? "win" : "loss")
+					<< ", move: " << result.move.toString() << std::endl;
+			}
+			return board;
+		}
+	}
+
+	return searchMove(board);
+}
+
+template<int N>
+BoardT<N> MinmaxPlayer::searchMove(BoardT<N> board) {
+	if (playTablebaseMove(board)) return board;
+
 	Move move;
 	int lastCutoffs = cutoffs;
 	double score = minmax(board, depth, &move);
-	std::cout << "AI Player generated move with score: " << score << std::endl;
-	std::cout << "\tcutoffs: " << cutoffs - lastCutoffs << std::endl;
 	move.apply(board);
-	std::cout << "board material score: " << scoreMaterial(board) << std::endl;
-	std::cout << "move: " << move.toString() << std::endl;
+	if (verbose) {
+		std::cout << "AI Player generated move with score: " << score << std::endl;
+		std::cout << "\tcutoffs: " << cutoffs - lastCutoffs << std::endl;
+		std::cout << "board material score: " << scoreMaterial(board) << std::endl;
+		std::cout << "move: " << move.toString<N>() << std::endl;
+	}
 	return board;
 }
 
-double MinmaxPlayer::scoreBoard(const Board& board) {
-	double mat =  this->scoreMaterial(board);
-
-	int horDjkWhite;
-	int vrtDjkWhite;
-	int horDjkBlack;
-	int vrtDjkBlack;
-
-	board.getDjikstraScore(1, &horDjkWhite, &vrtDjkWhite);
-	board.getDjikstraScore(-1, &vrtDjkBlack, &horDjkBlack);
-
-	horDjkWhite = Board::SIZE - horDjkWhite;
-	horDjkBlack = Board::SIZE - horDjkBlack;
-	vrtDjkWhite = Board::SIZE - vrtDjkWhite;
-	vrtDjkBlack = Board::SIZE - vrtDjkBlack;
-
-	double djk = horDjkWhite - horDjkBlack + vrtDjkWhite - vrtDjkBlack;
-
-	return djk * 4.0 + mat;
+template<int N>
+double MinmaxPlayer::scoreBoard(const BoardT<N>& board) {
+	double score = eval::scoreBoard(board, weights.data());
+	if (mobility != 0.0)
+		score += mobility * (board.count_spreads(1) - board.count_spreads(-1));
+	return score;
 }
 
-double MinmaxPlayer::scoreMaterial(const Board& board) {
-	double score = 0;
-
-	for (int y = 0; y < Board::SIZE; ++y) {
-		for (int x = 0; x < Board::SIZE; ++x) {
-			const Stack& st = board.stacks[INDEX_BOARD(x, y)];
-
-			int8_t top = st.top();
-			if (top == 0) continue;
-
-			// value for the stack count and range and all that jazzzyness.
-			const std::bitset<48> whitePieces = st.stack();
-			const std::bitset<48> blackPieces = ~whitePieces;
-
-			double stratValue = 0;
-
-			int numWhitePieces = whitePieces.count() - (whitePieces >> 5).count();
-			int numBlackPieces = blackPieces.count() - (blackPieces >> 5).count();
-
-			if (top > 0) {
-				stratValue += (numWhitePieces * 1.3 - numBlackPieces) * 0.3;
-			} else {
-				stratValue += (numBlackPieces * 1.3 - numWhitePieces) * 0.3;
-			}
-
-			// buff for having neighbors of the same color
-			double castleBuff = 1.0;
-			if (x > 0 && board.stacks[INDEX_BOARD(x - 1, y)].top() * top > 0) {
-				castleBuff *= 2.0;
-			}
-			if (y > 0 && board.stacks[INDEX_BOARD(x, y - 1)].top() * top > 0) {
-				castleBuff *= 2.0;
-			}
-			if (y > 0 && x > 0 && board.stacks[INDEX_BOARD(x - 1, y - 1)].top() * top > 0) {
-				castleBuff *= 2.0;
-			}
-			if (castleBuff != 1.0)
-				stratValue += castleBuff * 0.2;
-
-			// buff for a hard cap if possible!
-			if (top == PIECE_CAP) {
-				if (whitePieces[st.size() - 2] == 1)
-					stratValue += 2;
-			} else if (top == -PIECE_CAP) {
-				if (blackPieces[st.size() - 2] == 1)
-					stratValue += 2;
-			}
-
-			// placement value
-			stratValue -= (abs(x - 2) + abs(y - 2)) * 0.075;
+template<int N>
+double MinmaxPlayer::scoreMaterial(const BoardT<N>& board) {
+	return eval::scoreMaterial(board, weights.data());
+}
 
-			if (top > 0)
-				score += stratValue + 1.0;
-			else
-				score -= stratValue + 1.0;
-		}
-	}
+#define INSTANTIATE_MINMAX(N) \
+	template BoardT<N> MinmaxPlayer::searchMove<N>(BoardT<N> board); \
+	template double MinmaxPlayer::minmax<N>(BoardT<N>& board, int depth, Move* result, double alpha, double beta);
 
-	return score;
-}
+INSTANTIATE_MINMAX(3)
+INSTANTIATE_MINMAX(4)
+INSTANTIATE_MINMAX(5)
+INSTANTIATE_MINMAX(6)
+INSTANTIATE_MINMAX(7)
+INSTANTIATE_MINMAX(8)
@@ -0,0 +1,113 @@
+#include "playout.h"
+#include "movegen.h"
+#include "helpers.h"
+#include "threats.h"
+
+namespace playout {
+	// NOTE: after this many rejected samples fall back to generating every move
+	const int MAX_ATTEMPTS = 64;
+
+	const std::vector<MoveInternal> no_moves;
+
+	bool randomMove(const Board& board, uint32_t* moveid) {
+		const int8_t team = board.playerTurn;
+		const int reserve = board.placementColor() > 0 ? 0 : 1;
+
+		for (int attempt = 0; attempt < MAX_ATTEMPTS; ++attempt) {
+			const uint64_t r = fast_rand();
+			const int square = ((r & 0xffffffff) * Board::SQUARES) >> 32;
+			const Stack& stack = board.stacks[square];
+			const int8_t top = stack.top();
+
+			if (top == 0) {
+				if (board.moveno < 2) {
+					*moveid = movegen::placements[square][0].moveid;
+					return true;
+				}
+
+				// flat, wall or cap, out of the ones still in reserve
+				const bool stones = board.piecesleft[reserve] > 0;
+				const bool cap = board.capstones[reserve] > 0;
+				const int choices = (stones ? 2 : 0) + (cap ? 1 : 0);
+				if (choices == 0) continue;
+
+				int piece = stones ? (int)(((r >> 32) * choices) >> 32) : 2;
+				*moveid = movegen::placements[square][piece].moveid;
+				return true;
+			}
+
+			if (top * team > 0 && board.moveno >= 2) {
+				const int limit = stack.size() < Board::SIZE ? stack.size() : Board::SIZE;
+				const int count = 1 + (int)((((r >> 32) & 0xffff) * limit) >> 16);
+
+				const std::vector<MoveInternal>& cuts = movegen::cuts[square][count];
+				const std::vector<MoveInternal>& flatten = top * team == PIECE_CAP ? movegen::cuts_flatten[square][count] : no_moves;
+
+				const size_t j = fast_rand_range(cuts.size() + flatten.size());
+				const MoveInternal& move = j < cuts.size() ? cuts[j] : flatten[j - cuts.size()];
+				if (move.can_move(board)) {
+					*moveid = move.moveid;
+					return true;
+				}
+			}
+		}
+
+		std::vector<Move> moves = board.get_moves();
+		if (moves.empty()) return false;
+		*moveid = moves[fast_rand_range(moves.size())].moveid;
+		return true;
+	}
+
+	// true if all the squares are in a single row or column, so that one spread could cover them
+	static bool inOneLine(uint64_t squares) {
+		for (int i = 0; i < Board::SIZE; ++i) {
+			uint64_t row = ((1ULL << Board::SIZE) - 1) << (i * Board::SIZE);
+			uint64_t column = 0;
+			for (int j = 0; j < Board::SIZE; ++j)
+				column |= 1ULL << INDEX_BOARD(i, j);
+			if ((squares & ~row) == 0 || (squares & ~column) == 0)
+				return true;
+		}
+		return false;
+	}
+
+	int decidedByThreats(const Board& board) {
+		if (board.moveno < 2) return 0;
+
+		const int8_t team = board.playerTurn;
+		const int reserve = team > 0 ? 0 : 1;
+
+		// the player to move completes a road with a placement
+		if ((board.piecesleft[reserve] > 0 || board.capstones[reserve] > 0) && board.roadThreats(team) != 0)
+			return team;
+
+		// two threats that no single placement can block, as long as no move at all stops the opponent
+		// NOTE: the threats are only a quick filter, a spread may still capture part of the road or win first
+		uint64_t against = board.roadThreats(-team);
+		if ((against & (against - 1)) != 0 && !inOneLine(against)) {
+			Board copy = board;
+			if (!threats::defends(copy)) return -team;
+		}
+
+		return 0;
+	}
+
+	int play(Board& board, std::vector<unsigned int>* moveids, int maxPlies, bool stopOnThreats) {
+		for (int ply = 0; ply < maxPlies; ++ply) {
+			int winner = board.getWinner();
+			if (winner != 0) return winner;
+
+			if (stopOnThreats) {
+				winner = decidedByThreats(board);
+				if (winner != 0) return winner;
+			}
+
+			uint32_t moveid;
+			if (!randomMove(board, &moveid)) return 0;
+
+			movegen::all_moves[moveid].apply(board);
+			if (moveids) moveids->push_back(moveid);
+		}
+		return board.getWinner();
+	}
+}
@@ -0,0 +1,30 @@
+#ifndef __PLAYOUT_H_
+#define __PLAYOUT_H_
+
+#include <vector>
+
+#include "board.h"
+
+/**
+	fast random playouts for MCTS
+*/
+
+namespace playout {
+	// give up on a game that goes on for this many plies and call it a draw
+	const int MAX_PLIES = 1000;
+
+	// sample a random legal move without generating the full move list, returns false if there is none. the move is
+	// not uniform over the legal ones: a square is picked first, then a piece to place or a number of pieces to carry,
+	// then one of the ways to drop them, and illegal picks are drawn again. every square with a move is about as likely
+	// as any other, so a lone placement is played far more often than any one spread of a tall stack
+	bool randomMove(const Board& board, uint32_t* moveid);
+
+	// the winner if the game is decided by a road threat even though it is not over yet, otherwise 0
+	int decidedByThreats(const Board& board);
+
+	// play random moves on the board in place until the game ends or maxPlies are played, optionally stopping as soon
+	// as a road threat decides the game. returns the winner, or 0 if the game is drawn or undecided
+	int play(Board& board, std::vector<unsigned int>* moveids = nullptr, int maxPlies = MAX_PLIES, bool stopOnThreats = false);
+}
+
+#endif
@@ -0,0 +1,96 @@
+#include <cmath>
+#include <cstdlib>
+
+#include "policy.h"
+#include "movegen.h"
+#include "eval.h"
+
+namespace policy {
+	// NOTE: the positional weights are the ones of the evaluation, eval::weights, so tuned weights steer the priors too
+	const float OPENING_CORNER = 0.5;  // per square of distance from the center, for the opponent's first piece
+	const float ROAD_WIN = 10.0;       // placement that completes a road
+	const float BLOCK = 3.0;           // placement on a square that completes a road for the opponent
+	const float WALL = -1.0;
+	const float CAP = -0.5;
+	const float SPREAD = -0.5;
+	const float CAP_MOVE = 0.5;
+
+	static int centerDistance(int8_t position) {
+		// doubled so that even board sizes have an integer center
+		int x = position % Board::SIZE * 2 - (Board::SIZE - 1);
+		int y = position / Board::SIZE * 2 - (Board::SIZE - 1);
+		return (abs(x) + abs(y)) / 2;
+	}
+
+	static int roadNeighbors(int8_t position, uint64_t road) {
+		int x = position % Board::SIZE;
+		int y = position / Board::SIZE;
+		int count = 0;
+		if (x > 0 && (road >> (position - 1) & 1)) count++;
+		if (x < Board::SIZE - 1 && (road >> (position + 1) & 1)) count++;
+		if (y > 0 && (road >> (position - Board::SIZE) & 1)) count++;
+		if (y < Board::SIZE - 1 && (road >> (position + Board::SIZE) & 1)) count++;
+		return count;
+	}
+
+	void scoreMoves(const Board& board, const std::vector<Move>& moves, std::vector<float>& scores) {
+		const int8_t team = board.playerTurn;
+		const uint64_t road = board.roadBits(team);
+		const uint64_t threats = board.roadThreats(team);
+		const uint64_t opponentThreats = board.roadThreats(-team);
+
+		scores.resize(moves.size());
+		for (size_t i = 0; i < moves.size(); ++i) {
+			const MoveInternal& move = movegen::all_moves[moves[i].moveid];
+			float score = 0;
+
+			if (move.type == MoveInternal::TYPE_PLACE) {
+				const uint64_t square = 1ULL << move.position;
+
+				// the first two moves place a piece for the opponent, the further from the center the better
+				if (board.moveno < 2) {
+					scores[i] = OPENING_CORNER * centerDistance(move.position);
+					continue;
+				}
+
+				score -= eval::weights[eval::CENTER] * centerDistance(move.position);
+				if (move.piece == PIECE_WALL) {
+					score += WALL;
+				} else {
+					score += eval::weights[eval::NEIGHBOR] * roadNeighbors(move.position, road);
+					if (threats & square) score += ROAD_WIN;
+				}
+				if (move.piece == PIECE_CAP) score += CAP;
+				if (opponentThreats & square) score += BLOCK;
+			} else {
+				score += SPREAD;
+				if (board.stacks[move.position].top() * team == PIECE_CAP) score += CAP_MOVE;
+				for (int j = 0; j < move.split_count; ++j) {
+					const Stack& target = board.stacks[move.split_positions[j]];
+					if (target.top() * team < 0)
+						score += eval::weights[eval::STACK] * target.size();
+				}
+				if (move.type == MoveInternal::TYPE_SPLIT_SQUASH) score += eval::weights[eval::HARD_CAP];
+			}
+
+			scores[i] = score;
+		}
+	}
+
+	void priors(const Board& board, const std::vector<Move>& moves, std::vector<float>& priors) {
+		scoreMoves(board, moves, priors);
+		if (priors.empty()) return;
+
+		float max = priors[0];
+		for (float score : priors)
+			if (score > max) max = score;
+
+		float total = 0;
+		for (float& score : priors) {
+			score = std::exp(score - max);
+			total += score;
+		}
+		for (float& score : priors)
+			score /= total;
+	}
+}
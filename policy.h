@@ -0,0 +1,20 @@
+#ifndef __POLICY_H_
+#define __POLICY_H_
+
+#include <vector>
+
+#include "board.h"
+
+/**
+	cheap handcrafted move policy, used for the priors of PUCT and for move ordering
+*/
+
+namespace policy {
+	// the score of every move for the player to move, higher is more promising
+	void scoreMoves(const Board& board, const std::vector<Move>& moves, std::vector<float>& scores);
+
+	// prior probabilities of the moves for the player to move, a softmax over their scores that sums to 1
+	void priors(const Board& board, const std::vector<Move>& moves, std::vector<float>& priors);
+}
+
+#endif
@@ -0,0 +1,142 @@
+#include <algorithm>
+
+#include "proof.h"
+
+namespace proof {
+	const uint32_t INFINITE = 0xffffffff;
+
+	// a sum of numbers that are not infinite must not become a proof
+	static inline uint32_t saturate(uint64_t value) {
+		return value >= INFINITE ? INFINITE - 1 : value;
+	}
+
+	Solver::Solver(int tableBits) : _table((size_t)1 << tableBits), _mask(((uint64_t)1 << tableBits) - 1) { }
+
+	bool Solver::lookup(uint64_t hash, uint32_t* pn, uint32_t* dn) const {
+		const Entry& entry = _table[hash & _mask];
+		if (entry.hash != hash) return false;
+		*pn = entry.pn;
+		*dn = entry.dn;
+		return true;
+	}
+
+	void Solver::store(uint64_t hash, uint32_t pn, uint32_t dn) {
+		// NOTE: always replace, the entries a search keeps coming back to are the ones it just wrote
+		Entry& entry = _table[hash & _mask];
+		entry.hash = hash;
+		entry.pn = pn;
+		entry.dn = dn;
+	}
+
+	void Solver::storeResult(uint64_t hash, int winner) {
+		if (winner == _attacker) store(hash, 0, INFINITE);
+		else store(hash, INFINITE, 0);
+	}
+
+	Result Solver::solve(const Board& board, unsigned long maxNodes, Move* best) {
+		if (findWin(board, maxNodes, best)) return WIN;
+
+		Board copy = board;
+		if (_nodes < maxNodes && prove(copy, -copy.playerTurn, maxNodes)) return LOSS;
+		return UNKNOWN;
+	}
+
+	bool Solver::findWin(const Board& board, unsigned long maxNodes, Move* best) {
+		Board copy = board;
+		_nodes = 0;
+		if (!prove(copy, copy.playerTurn, maxNodes)) return false;
+		if (best) *best = _best;
+		return true;
+	}
+
+	bool Solver::prove(Board& board, int attacker, unsigned long maxNodes) {
+		// NOTE: entries hold the numbers for one attacker and one root, start over every time
+		std::fill(_table.begin(), _table.end(), Entry());
+		_attacker = attacker;
+		_maxNodes = maxNodes;
+
+		// NOTE: the table always replaces, a descendant can take the slot of the root, so its result is not read back
+		return search(board, INFINITE, INFINITE, 0) == 0;
+	}
+
+	uint32_t Solver::search(Board& board, uint32_t thpn, uint32_t thdn, int depth) {
+		_nodes++;
+		const uint64_t hash = board.hash();
+
+		const int winner = board.getWinner();
+		if (winner != 0 || depth >= maxDepth) {
+			storeResult(hash, winner);
+			return winner == _attacker ? 0 : INFINITE;
+		}
+
+		std::vector<Move> moves = board.get_moves();
+		if (moves.empty()) {
+			storeResult(hash, 0);
+			return INFINITE;
+		}
+
+		// NOTE: children are hashed and checked for a decided game once, the loop below only reads the table
+		std::vector<uint64_t> children(moves.size());
+		for (size_t i = 0; i < moves.size(); ++i) {
+			moves[i].apply(board);
+			children[i] = board.hash();
+			uint32_t pn, dn;
+			const int childWinner = board.getWinner();
+			if (childWinner != 0 && !lookup(children[i], &pn, &dn))
+				storeResult(children[i], childWinner);
+			moves[i].revert(board);
+		}
+
+		// the attacker picks the child easiest to prove, the defender the one easiest to disprove
+		const bool orNode = board.playerTurn == _attacker;
+		while (true) {
+			size_t selected = 0;
+			uint32_t best = INFINITE;
+			uint32_t second = INFINITE;
+			uint32_t selectedPn = 1, selectedDn = 1;
+			uint64_t sum = 0;
+			bool infinite = false;
+
+			for (size_t i = 0; i < children.size(); ++i) {
+				uint32_t pn = 1, dn = 1;
+				lookup(children[i], &pn, &dn);
+
+				const uint32_t value = orNode ? pn : dn;
+				const uint32_t other = orNode ? dn : pn;
+				if (value < best) {
+					second = best;
+					best = value;
+					selected = i;
+					selectedPn = pn;
+					selectedDn = dn;
+				} else if (value < second) {
+					second = value;
+				}
+				if (other == INFINITE) infinite = true;
+				sum += other;
+			}
+
+			const uint32_t total = infinite ? INFINITE : saturate(sum);
+			const uint32_t pn = orNode ? best : total;
+			const uint32_t dn = orNode ? total : best;
+			store(hash, pn, dn);
+
+			if (depth == 0 && orNode && pn == 0) _best = moves[selected];
+			if (pn >= thpn || dn >= thdn || _nodes >= _maxNodes) return pn;
+
+			uint32_t childPn, childDn;
+			const uint32_t next = second == INFINITE ? INFINITE : second + 1;
+			if (orNode) {
+				childPn = std::min(thpn, next);
+				childDn = thdn == INFINITE ? INFINITE : saturate((uint64_t)thdn - dn + selectedDn);
+			} else {
+				childDn = std::min(thdn, next);
+				childPn = thpn == INFINITE ? INFINITE : saturate((uint64_t)thpn - pn + selectedPn);
+			}
+
+			moves[selected].apply(board);
+			search(board, childPn, childDn, depth + 1);
+			moves[selected].revert(board);
+		}
+	}
+}
@@ -0,0 +1,69 @@
+#ifndef __PROOF_H_
+#define __PROOF_H_
+
+#include <stdint.h>
+#include <vector>
+
+#include "board.h"
+
+/**
+	depth first proof number search (df-pn) for forced wins. the attacker wins a position once getWinner says so,
+	anything else at the end of the search, a draw or running out of depth, counts against it. proof and disproof
+	numbers are kept in a fixed size table keyed by board hash, the board hash includes the move number so positions
+	never repeat and a table entry always sits at the same depth from the root.
+*/
+
+namespace proof {
+	enum Result {
+		LOSS = -1,
+		UNKNOWN = 0,
+		WIN = 1,
+	};
+
+	const int DEFAULT_TABLE_BITS = 20;
+	const int DEFAULT_MAX_DEPTH = 16;
+
+	class Solver {
+	public:
+		// the table holds 2^tableBits positions, 16 bytes each
+		Solver(int tableBits = DEFAULT_TABLE_BITS);
+
+		// plies searched below the root, lines that run longer are not wins
+		int maxDepth = DEFAULT_MAX_DEPTH;
+
+		// whether the side to move wins or loses by force. the win is searched for first and the loss gets what is
+		// left of the node budget. the winning move is stored in best when there is one
+		Result solve(const Board& board, unsigned long maxNodes, Move* best = nullptr);
+
+		// only the first half of solve, true if the side to move wins by force
+		bool findWin(const Board& board, unsigned long maxNodes, Move* best = nullptr);
+
+		// positions expanded by the last search
+		unsigned long nodes() const { return _nodes; }
+
+	private:
+		struct Entry {
+			uint64_t hash;
+			uint32_t pn;
+			uint32_t dn;
+		};
+
+		std::vector<Entry> _table;
+		uint64_t _mask;
+
+		int _attacker = 0;
+		unsigned long _nodes = 0;
+		unsigned long _maxNodes = 0;
+		Move _best;
+
+		bool prove(Board& board, int attacker, unsigned long maxNodes);
+		// returns the proof number the position is left with, the table entry may already be overwritten
+		uint32_t search(Board& board, uint32_t thpn, uint32_t thdn, int depth);
+
+		bool lookup(uint64_t hash, uint32_t* pn, uint32_t* dn) const;
+		void store(uint64_t hash, uint32_t pn, uint32_t dn);
+		void storeResult(uint64_t hash, int winner);
+	};
+}
+
+#endif
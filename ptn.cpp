@@ -0,0 +1,365 @@
+#include <cstring>
+
+#include "ptn.h"
+#include "movegen.h"
+
+namespace ptn {
+	static bool parseSquare(const char*& p, const char* end, int* square) {
+		if (end - p < 2) return false;
+		const int x = (p[0] | 0x20) - 'a';
+		const int y = p[1] - '1';
+		if (x < 0 || x >= Board::SIZE || y < 0 || y >= Board::SIZE) return false;
+		*square = INDEX_BOARD(x, y);
+		p += 2;
+		return true;
+	}
+
+	static void writeSquare(std::string& out, int square) {
+		out += (char)('a' + square % Board::SIZE);
+		out += (char)('1' + square / Board::SIZE);
+	}
+
+	static bool isLegal(const Board& board, const MoveInternal& move) {
+		if (move.type == MoveInternal::TYPE_PLACE)
+			return board.stacks[move.position].top() == 0 && move.can_move(board);
+
+		const Stack& stack = board.stacks[move.position];
+		const int8_t top = stack.top() * board.playerTurn;
+		int count = 0;
+		for (int i = 0; i < move.split_count; ++i)
+			count += move.split_sizes[i];
+
+		if (board.moveno < 2 || top <= 0 || count > stack.size()) return false;
+		if (move.type == MoveInternal::TYPE_SPLIT_SQUASH && top != PIECE_CAP) return false;
+		return move.can_move(board);
+	}
+
+	bool parseMove(const Board& board, const char* str, size_t length, uint32_t* moveid) {
+		const char* p = str;
+		const char* end = str + length;
+		while (end != p && strchr("!?'\"*", end[-1])) end--;
+		if (p == end) return false;
+
+		int count = 0;
+		int piece = 0; // index into movegen::placements
+		if (*p >= '1' && *p <= '9') {
+			count = *p++ - '0';
+		} else if (*p == 'F' || *p == 'S' || *p == 'C') {
+			piece = *p == 'F' ? 0 : (*p == 'S' ? 1 : 2);
+			p++;
+		}
+
+		int square;
+		if (!parseSquare(p, end, &square)) return false;
+
+		if (p == end) {
+			if (count != 0) return false;
+			const MoveInternal& move = movegen::placements[square][piece];
+			*moveid = move.moveid;
+			return isLegal(board, move);
+		}
+
+		if (piece != 0) return false;
+		if (count == 0) count = 1;
+		if (count > Board::SIZE) return false;
+
+		int d;
+		switch (*p++) {
+		case '>': d = 1; break;
+		case '<': d = -1; break;
+		case '+': d = Board::SIZE; break;
+		case '-': d = -Board::SIZE; break;
+		default: return false;
+		}
+
+		int8_t drops[Board::SIZE];
+		int dropCount = 0;
+		int total = 0;
+		while (p != end) {
+			if (*p < '1' || *p > '9' || dropCount == Board::SIZE) return false;
+			drops[dropCount] = *p++ - '0';
+			total += drops[dropCount++];
+		}
+		if (dropCount == 0) {
+			drops[dropCount++] = count;
+			total = count;
+		}
+		if (total != count) return false;
+
+		// NOTE: a lone piece landing on a wall can only be a capstone flattening it
+		const int last = square + d * dropCount;
+		if (last < 0 || last >= Board::SQUARES) return false;
+		const int8_t landing = board.stacks[last].top();
+		const bool squash = (landing == PIECE_WALL || landing == -PIECE_WALL);
+
+		for (const MoveInternal& move : (squash ? movegen::cuts_flatten : movegen::cuts)[square][count]) {
+			if (move.split_count != dropCount || move.split_positions[0] != square + d) continue;
+			if (memcmp(move.split_sizes, drops, dropCount) != 0) continue;
+			*moveid = move.moveid;
+			return isLegal(board, move);
+		}
+		return false;
+	}
+
+	std::string moveToString(uint32_t moveid) {
+		const MoveInternal& move = movegen::all_moves[moveid];
+		std::string out;
+
+		if (move.type == MoveInternal::TYPE_PLACE) {
+			if (move.piece == PIECE_WALL) out += 'S';
+			if (move.piece == PIECE_CAP) out += 'C';
+			writeSquare(out, move.position);
+			return out;
+		}
+
+		int count = 0;
+		for (int i = 0; i < move.split_count; ++i)
+			count += move.split_sizes[i];
+
+		if (count > 1) out += (char)('0' + count);
+		writeSquare(out, move.position);
+		switch (move.split_positions[0] - move.position) {
+		case 1: out += '>'; break;
+		case -1: out += '<'; break;
+		case Board::SIZE: out += '+'; break;
+		case -Board::SIZE: out += '-'; break;
+		}
+		if (move.split_count > 1) {
+			for (int i = 0; i < move.split_count; ++i)
+				out += (char)('0' + move.split_sizes[i]);
+		}
+		if (move.type == MoveInternal::TYPE_SPLIT_SQUASH) out += '*';
+		return out;
+	}
+
+	bool parseTPS(const char* str, size_t length, Board* board) {
+		const char* p = str;
+		const char* end = str + length;
+		Board result;
+		int used[2] = {0, 0}; // stones taken out of the reserves
+		int caps[2] = {0, 0};
+
+		for (int row = 0; row < Board::SIZE; ++row) {
+			const int y = Board::SIZE - 1 - row;
+			int x = 0;
+			while (true) {
+				if (p == end) return false;
+				if (*p == 'x') {
+					p++;
+					int empty = 1;
+					if (p != end && *p >= '1' && *p <= '9') empty = *p++ - '0';
+					x += empty;
+					if (x > Board::SIZE) return false;
+				} else {
+					if (x >= Board::SIZE) return false;
+					const int square = INDEX_BOARD(x++, y);
+					int height = 0;
+					while (p != end && (*p == '1' || *p == '2')) {
+						const int8_t color = *p++ == '1' ? 1 : -1;
+						if (++height > 48) return false;
+						result.place(square, color * PIECE_FLAT);
+					}
+					if (height == 0) return false;
+
+					const int8_t color = result.stacks[square].top() > 0 ? 1 : -1;
+					const int side = color > 0 ? 0 : 1;
+					used[0] += result.stacks[square].piecesOfColor(1);
+					used[1] += result.stacks[square].piecesOfColor(-1);
+					if (p != end && (*p == 'S' || *p == 'C')) {
+						result.remove(square);
+						result.place(square, color * (*p == 'S' ? PIECE_WALL : PIECE_CAP));
+						if (*p == 'C') {
+							used[side]--;
+							caps[side]++;
+						}
+						p++;
+					}
+				}
+
+				if (p != end && *p == ',') {
+					p++;
+					continue;
+				}
+				break;
+			}
+			if (x != Board::SIZE) return false;
+			if (row + 1 < Board::SIZE) {
+				if (p == end || *p != '/') return false;
+				p++;
+			}
+		}
+
+		if (p == end || *p++ != ' ') return false;
+		if (p == end || (*p != '1' && *p != '2')) return false;
+		result.playerTurn = *p++ == '1' ? 1 : -1;
+		if (p == end || *p++ != ' ') return false;
+
+		int moveNumber = 0;
+		while (p != end && *p >= '0' && *p <= '9' && moveNumber < 100000)
+			moveNumber = moveNumber * 10 + (*p++ - '0');
+		if (moveNumber < 1 || p != end) return false;
+		result.moveno = 2 * (moveNumber - 1) + (result.playerTurn < 0 ? 1 : 0);
+
+		for (int side = 0; side < 2; ++side) {
+			result.piecesleft[side] = Board::PIECES_PER_SIDE - used[side];
+			result.capstones[side] = 1 - caps[side];
+			if (result.piecesleft[side] < 0 || result.capstones[side] < 0) return false;
+		}
+
+		*board = result;
+		return true;
+	}
+
+	std::string toTPS(const Board& board) {
+		std::string out;
+		for (int row = 0; row < Board::SIZE; ++row) {
+			const int y = Board::SIZE - 1 - row;
+			if (row > 0) out += '/';
+			int empty = 0;
+			for (int x = 0; x < Board::SIZE; ++x) {
+				const Stack& stack = board.stacks[INDEX_BOARD(x, y)];
+				if (stack.size() == 0) {
+					empty++;
+					continue;
+				}
+				if (empty > 0) {
+					out += 'x';
+					if (empty > 1) out += (char)('0' + empty);
+					out += ',';
+					empty = 0;
+				}
+				for (int i = 0; i < stack.size(); ++i)
+					out += stack.isWhite(i) ? '1' : '2';
+				const int8_t top = stack.top() > 0 ? stack.top() : -stack.top();
+				if (top == PIECE_WALL) out += 'S';
+				if (top == PIECE_CAP) out += 'C';
+				if (x + 1 < Board::SIZE) out += ',';
+			}
+			if (empty > 0) {
+				out += 'x';
+				if (empty > 1) out += (char)('0' + empty);
+			}
+		}
+		out += board.playerTurn > 0 ? " 1 " : " 2 ";
+		out += std::to_string(board.moveno / 2 + 1);
+		return out;
+	}
+
+	const std::string* Game::tag(const std::string& name) const {
+		for (const auto& tag : tags) {
+			if (tag.first == name) return &tag.second;
+		}
+		return nullptr;
+	}
+
+	bool Reader::readLine() {
+		if (_pending) {
+			_pending = false;
+			return true;
+		}
+		if (!std::getline(_in, _line)) return false;
+		if (!_line.empty() && _line.back() == '\r') _line.pop_back();
+		return true;
+	}
+
+	static bool parseTag(const std::string& line, std::pair<std::string, std::string>* tag) {
+		size_t space = line.find(' ');
+		size_t open = line.find('"');
+		size_t close = line.rfind('"');
+		if (space == std::string::npos || open == std::string::npos || close <= open) return false;
+		tag->first = line.substr(1, space - 1);
+		tag->second = line.substr(open + 1, close - open - 1);
+		return true;
+	}
+
+	static bool parseResult(const std::string& token, int* result) {
+		if (token == "R-0" || token == "F-0" || token == "1-0") *result = 1;
+		else if (token == "0-R" || token == "0-F" || token == "0-1") *result = -1;
+		else if (token == "1/2-1/2" || token == "0-0") *result = 0;
+		else return false;
+		return true;
+	}
+
+	void Reader::parseMoves(const std::string& text, Game* game, Board* board, bool* inComment, bool* done) {
+		const char* p = text.c_str();
+		const char* end = p + text.length();
+
+		while (p != end && !*done) {
+			if (*inComment) {
+				while (p != end && *p != '}') p++;
+				if (p != end) {
+					p++;
+					*inComment = false;
+				}
+				continue;
+			}
+			if (*p == '{') {
+				*inComment = true;
+				p++;
+				continue;
+			}
+			if (*p == ' ' || *p == '\t') {
+				p++;
+				continue;
+			}
+
+			const char* token = p;
+			while (p != end && *p != ' ' && *p != '\t' && *p != '{') p++;
+			const size_t length = p - token;
+
+			// NOTE: move numbers look like "12."
+			if (token[length - 1] == '.') continue;
+			if (parseResult(std::string(token, length), &game->result)) {
+				*done = true;
+				break;
+			}
+			if (!game->error.empty()) continue;
+
+			uint32_t moveid;
+			if (!parseMove(*board, token, length, &moveid)) {
+				game->error = "illegal move " + std::string(token, length) + " at ply " + std::to_string(game->moveids.size() + 1);
+				continue;
+			}
+			movegen::all_moves[moveid].apply(*board);
+			game->moveids.push_back(moveid);
+		}
+	}
+
+	bool Reader::next(Game* game) {
+		*game = Game();
+		Board board;
+		bool inComment = false;
+		bool done = false;
+		bool sawMoves = false;
+		bool started = false;
+
+		while (!done && readLine()) {
+			if (_line.empty()) continue;
+
+			if (_line[0] == '[' && !inComment) {
+				if (sawMoves) {
+					// NOTE: a game without a result token ends where the next one's tags start
+					_pending = true;
+					break;
+				}
+				started = true;
+				std::pair<std::string, std::string> tag;
+				if (!parseTag(_line, &tag)) continue;
+				game->tags.push_back(tag);
+
+				if (tag.first == "Size" && tag.second != std::to_string(Board::SIZE)) {
+					game->error = "unsupported size " + tag.second;
+				} else if (tag.first == "TPS" && game->error.empty()) {
+					if (!parseTPS(tag.second.c_str(), tag.second.length(), &game->start))
+						game->error = "invalid TPS " + tag.second;
+				}
+				continue;
+			}
+
+			if (!sawMoves) board = game->start;
+			sawMoves = started = true;
+			parseMoves(_line, game, &board, &inComment, &done);
+		}
+		return started;
+	}
+}
@@ -0,0 +1,61 @@
+#ifndef __PTN_H_
+#define __PTN_H_
+
+#include <istream>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "board.h"
+
+/**
+	PTN (portable tak notation) moves and games, and TPS (tak positional system) boards, for importing community
+	games. squares are named like Move::toString does, files a-e are x and ranks 1-5 are y.
+*/
+
+namespace ptn {
+	// the moveid of a PTN move such as "c3", "Sa1" or "3c3>111" on this board. returns false if the move cannot be
+	// parsed or is not legal. trailing annotations like "!", "?", "'" and the squash marker "*" are accepted.
+	bool parseMove(const Board& board, const char* str, size_t length, uint32_t* moveid);
+
+	// the shortest PTN for the move, squashes are marked with "*"
+	std::string moveToString(uint32_t moveid);
+
+	// a TPS position such as "x5/x5/x3,12,x/x5/x5 1 3", reserves are worked out from the pieces on the board
+	bool parseTPS(const char* str, size_t length, Board* board);
+	std::string toTPS(const Board& board);
+
+	struct Game {
+		std::vector<std::pair<std::string, std::string>> tags;
+		Board start; // the empty board unless the game has a TPS tag
+		std::vector<uint32_t> moveids;
+		int result = 0; // +1 white won, -1 black won, 0 for a draw or no result
+		std::string error; // empty unless the game could not be replayed to the end
+
+		const std::string* tag(const std::string& name) const;
+	};
+
+	/**
+		reads PTN games one at a time out of a stream with any number of games back to back, replaying every move
+		while parsing so each game comes out as moveids ready for Move::apply
+	*/
+	class Reader {
+	public:
+		Reader(std::istream& in) : _in(in) { };
+
+		// returns false once the stream is exhausted. games with an unsupported size or an illegal move are still
+		// returned, with the moves up to the problem and the error set
+		bool next(Game* game);
+
+	private:
+		std::istream& _in;
+		std::string _line;
+		bool _pending = false; // _line holds the tag line of the next game
+
+		bool readLine();
+		void parseMoves(const std::string& text, Game* game, Board* board, bool* inComment, bool* done);
+	};
+}
+
+#endif
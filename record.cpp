@@ -0,0 +1,180 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "record.h"
+#include "movegen.h"
+
+namespace record {
+	void pack(const Board& board, PackedBoard* packed, int8_t result) {
+		bzero(packed, sizeof(PackedBoard));
+		packed->moveno = board.moveno;
+		packed->flags = (board.playerTurn < 0 ? 1 : 0) | (board.capstones[0] << 1) | (board.capstones[1] << 3);
+		packed->piecesleft[0] = board.piecesleft[0];
+		packed->piecesleft[1] = board.piecesleft[1];
+		packed->result = result;
+
+		int bit = 0;
+		auto emit = [&](int value) {
+			assert(bit < 128);
+			if (value) packed->pieces[bit >> 6] |= 1ull << (bit & 63);
+			bit++;
+		};
+
+		for (int i = 0; i < Board::SQUARES; ++i) {
+			const Stack& stack = board.stacks[i];
+			const int8_t top = stack.top();
+			packed->tops |= (uint64_t)(top > 0 ? top : -top) << (2 * i);
+			for (int j = 0; j < stack.size(); ++j) {
+				emit(1);
+				emit(stack.isWhite(j));
+			}
+			emit(0);
+		}
+	}
+
+	bool unpack(const PackedBoard& packed, Board* board) {
+		*board = Board();
+		board->moveno = packed.moveno;
+		board->playerTurn = (packed.flags & 1) ? -1 : 1;
+		board->capstones[0] = (packed.flags >> 1) & 3;
+		board->capstones[1] = (packed.flags >> 3) & 3;
+		board->piecesleft[0] = packed.piecesleft[0];
+		board->piecesleft[1] = packed.piecesleft[1];
+
+		int bit = 0;
+		auto take = [&]() {
+			const int value = (packed.pieces[bit >> 6] >> (bit & 63)) & 1;
+			bit++;
+			return value;
+		};
+
+		for (int i = 0; i < Board::SQUARES; ++i) {
+			const int8_t kind = (packed.tops >> (2 * i)) & 3;
+			while (true) {
+				if (bit >= 128) return false;
+				if (!take()) break;
+				if (bit >= 128) return false;
+				const int8_t color = take() ? 1 : -1;
+				board->place(i, color * PIECE_FLAT);
+			}
+
+			Stack& stack = board->stacks[i];
+			if ((stack.size() == 0) != (kind == 0)) return false;
+			if (stack.size() >= 48) return false;
+			if (kind != 0 && kind != PIECE_FLAT) {
+				// NOTE: only the top piece can be a wall or a cap, swap it in
+				const int8_t color = stack.top() > 0 ? 1 : -1;
+				stack.pop();
+				stack.push(color * kind);
+			}
+		}
+		return true;
+	}
+
+	bool Writer::open(const std::string& path, uint32_t magic) {
+		close();
+		_file = fopen(path.c_str(), "ab");
+		if (!_file) return false;
+		_magic = magic;
+
+		// NOTE: big buffer, datasets are written a few bytes at a time
+		setvbuf(_file, nullptr, _IOFBF, 1 << 20);
+		fseek(_file, 0, SEEK_END);
+		if (ftell(_file) == 0) {
+			FileHeader header = {magic, VERSION};
+			if (fwrite(&header, sizeof(header), 1, _file) != 1) {
+				close();
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void Writer::close() {
+		if (_file) fclose(_file);
+		_file = nullptr;
+	}
+
+	bool Writer::write(const Board& board, int8_t result) {
+		assert(_magic == POSITION_MAGIC);
+		PackedBoard packed;
+		pack(board, &packed, result);
+		return fwrite(&packed, sizeof(packed), 1, _file) == 1;
+	}
+
+	bool Writer::writeGame(const std::vector<unsigned int>& moveids, int8_t result) {
+		assert(_magic == GAME_MAGIC);
+		if (moveids.size() > UINT16_MAX) return false;
+
+		GameHeader header = {(uint16_t) moveids.size(), result, 0};
+		if (fwrite(&header, sizeof(header), 1, _file) != 1) return false;
+		for (unsigned int moveid : moveids) {
+			assert(moveid <= UINT16_MAX);
+			uint16_t id = moveid;
+			if (fwrite(&id, sizeof(id), 1, _file) != 1) return false;
+		}
+		return true;
+	}
+
+	bool MappedFile::open(const std::string& path, uint32_t magic) {
+		close();
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) return false;
+
+		struct stat st;
+		if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(FileHeader)) {
+			::close(fd);
+			return false;
+		}
+
+		void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		if (data == MAP_FAILED) return false;
+
+		_data = (const uint8_t*) data;
+		_size = st.st_size;
+
+		const FileHeader* header = (const FileHeader*) _data;
+		if (header->magic != magic || header->version != VERSION) {
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	void MappedFile::close() {
+		if (_data) munmap((void*) _data, _size);
+		_data = nullptr;
+		_size = 0;
+	}
+
+	bool Game::replay(int plies, Board* board) const {
+		*board = Board();
+		for (int i = 0; i < plies && i < this->plies; ++i) {
+			if (moveids[i] >= movegen::all_moves.size()) return false;
+			movegen::all_moves[moveids[i]].apply(*board);
+		}
+		return true;
+	}
+
+	bool GameReader::open(const std::string& path) {
+		_offset = 0;
+		return _file.open(path, GAME_MAGIC);
+	}
+
+	bool GameReader::next(Game* game) {
+		if (_offset + sizeof(GameHeader) > _file.size()) return false;
+
+		const GameHeader* header = (const GameHeader*) (_file.data() + _offset);
+		const size_t length = sizeof(GameHeader) + header->plies * sizeof(uint16_t);
+		if (_offset + length > _file.size()) return false;
+
+		game->moveids = (const uint16_t*) (_file.data() + _offset + sizeof(GameHeader));
+		game->plies = header->plies;
+		game->result = header->result;
+		_offset += length;
+		return true;
+	}
+}
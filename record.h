@@ -0,0 +1,141 @@
+#ifndef __RECORD_H_
+#define __RECORD_H_
+
+#include <cstdio>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "board.h"
+
+/**
+	compact binary positions and game records for datasets too big for TBG strings.
+
+	position files hold fixed size PackedBoards back to back, game files hold each game as a small header followed by
+	its moveids. both are append only and read back through mmap without copying. values are stored in native byte
+	order, these files are not meant to move between machines of different endianness.
+*/
+
+namespace record {
+	const uint32_t POSITION_MAGIC = 0x50414b54; // "TAKP"
+	const uint32_t GAME_MAGIC = 0x47414b54; // "TAKG"
+	const uint32_t VERSION = 1;
+
+	struct FileHeader {
+		uint32_t magic;
+		uint32_t version;
+	};
+
+	/**
+		a board in 32 bytes. tops holds 2 bits per square for the kind of the top piece (0 empty, 1 flat, 2 wall,
+		3 cap). pieces is a bit stream walking the squares in order, each piece is a 1 followed by its color (1 white)
+		and every square ends with a 0, at most 2 * 44 + 25 bits on a 5x5 board.
+	*/
+	struct PackedBoard {
+		uint16_t moveno;
+		uint8_t flags; // bit 0 black to move, bits 1-2 white capstones, bits 3-4 black capstones
+		uint8_t piecesleft[2];
+		int8_t result; // free label for datasets, usually the game result from white's point of view
+		uint8_t reserved[2];
+		uint64_t tops;
+		uint64_t pieces[2];
+	};
+	static_assert(sizeof(PackedBoard) == 32, "PackedBoard should stay 32 bytes");
+
+	void pack(const Board& board, PackedBoard* packed, int8_t result = 0);
+
+	// returns false if the packed board is malformed
+	bool unpack(const PackedBoard& packed, Board* board);
+
+	struct GameHeader {
+		uint16_t plies;
+		int8_t result; // +1 white won, -1 black won, 0 draw or unfinished
+		uint8_t reserved;
+	};
+
+	/**
+		appends to a record file, creating it with a header if it does not exist yet
+	*/
+	class Writer {
+	public:
+		Writer() { };
+		~Writer() { close(); }
+
+		bool open(const std::string& path, uint32_t magic);
+		void close();
+		bool isOpen() const { return _file != nullptr; }
+
+		// for position files
+		bool write(const Board& board, int8_t result = 0);
+
+		// for game files, every game starts from the empty board
+		bool writeGame(const std::vector<unsigned int>& moveids, int8_t result);
+
+	private:
+		FILE *_file = nullptr;
+		uint32_t _magic = 0;
+
+		Writer(const Writer&) = delete;
+		Writer& operator=(const Writer&) = delete;
+	};
+
+	/**
+		a read only memory mapping of a whole record file
+	*/
+	class MappedFile {
+	public:
+		MappedFile() { };
+		~MappedFile() { close(); }
+
+		bool open(const std::string& path, uint32_t magic);
+		void close();
+
+		// the contents after the file header
+		const uint8_t* data() const { return _data + sizeof(FileHeader); }
+		size_t size() const { return _size > sizeof(FileHeader) ? _size - sizeof(FileHeader) : 0; }
+
+	private:
+		const uint8_t *_data = nullptr;
+		size_t _size = 0;
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+	};
+
+	class PositionReader {
+	public:
+		bool open(const std::string& path) { return _file.open(path, POSITION_MAGIC); }
+
+		size_t count() const { return _file.size() / sizeof(PackedBoard); }
+		const PackedBoard* begin() const { return (const PackedBoard*) _file.data(); }
+		const PackedBoard* end() const { return begin() + count(); }
+		const PackedBoard& operator[](size_t i) const { return begin()[i]; }
+
+	private:
+		MappedFile _file;
+	};
+
+	struct Game {
+		const uint16_t *moveids; // points into the mapping
+		int plies;
+		int8_t result;
+
+		// the board after the first plies moves, returns false if a moveid is out of range
+		bool replay(int plies, Board* board) const;
+	};
+
+	class GameReader {
+	public:
+		bool open(const std::string& path);
+
+		// steps to the next game, returns false at the end of the file or on a truncated game
+		bool next(Game* game);
+		void rewind() { _offset = 0; }
+
+	private:
+		MappedFile _file;
+		size_t _offset = 0;
+	};
+}
+
+#endif
@@ -0,0 +1,68 @@
+#include <cmath>
+
+#include "stats.h"
+
+namespace stats {
+	void Results::add(int result) {
+		if (result > 0) wins++;
+		else if (result < 0) losses++;
+		else draws++;
+	}
+
+	double Results::score() const {
+		if (games() == 0) return 0.5;
+		return (wins + 0.5 * draws) / games();
+	}
+
+	double Results::variance() const {
+		if (games() == 0) return 0;
+		const double s = score();
+		return (wins * (1 - s) * (1 - s) + draws * (0.5 - s) * (0.5 - s) + losses * s * s) / games();
+	}
+
+	double scoreFromElo(double elo) {
+		return 1.0 / (1.0 + std::pow(10.0, -elo / 400.0));
+	}
+
+	double eloFromScore(double score) {
+		// NOTE: a perfect score has no finite elo, clamp it to something printable
+		const double epsilon = 1e-6;
+		if (score < epsilon) score = epsilon;
+		if (score > 1 - epsilon) score = 1 - epsilon;
+		return -400.0 * std::log10(1.0 / score - 1.0);
+	}
+
+	double elo(const Results& results, double* margin) {
+		const double s = results.score();
+		if (margin) {
+			*margin = 0;
+			if (results.games() > 0) {
+				const double error = std::sqrt(results.variance() / results.games()) * CONFIDENCE_Z;
+				*margin = (eloFromScore(s + error) - eloFromScore(s - error)) / 2;
+			}
+		}
+		return eloFromScore(s);
+	}
+
+	SPRT::SPRT(double elo0, double elo1, double alpha, double beta) {
+		_score0 = scoreFromElo(elo0);
+		_score1 = scoreFromElo(elo1);
+		_lower = std::log(beta / (1 - alpha));
+		_upper = std::log((1 - beta) / alpha);
+	}
+
+	double SPRT::llr() const {
+		const double variance = _results.variance();
+		// NOTE: all games ending the same way says nothing about the spread yet
+		if (variance <= 0) return 0;
+		const double s = _results.score();
+		return (_score1 - _score0) * (2 * s - _score0 - _score1) * _results.games() / (2 * variance);
+	}
+
+	int SPRT::status() const {
+		const double ratio = llr();
+		if (ratio >= _upper) return 1;
+		if (ratio <= _lower) return -1;
+		return 0;
+	}
+}
@@ -0,0 +1,65 @@
+#ifndef __STATS_H_
+#define __STATS_H_
+
+/**
+	match statistics, elo estimates and a sequential probability ratio test for deciding whether an engine change is
+	an improvement without playing a fixed, large number of games
+*/
+
+namespace stats {
+	// two sided 95% confidence
+	const double CONFIDENCE_Z = 1.959964;
+
+	// game counts from the point of view of the engine under test
+	struct Results {
+		int wins = 0;
+		int draws = 0;
+		int losses = 0;
+
+		// result is +1 for a win, 0 for a draw and -1 for a loss
+		void add(int result);
+
+		int games() const { return wins + draws + losses; }
+
+		// average points per game, 1 for a win and 0.5 for a draw
+		double score() const;
+
+		// variance of the points scored in a single game
+		double variance() const;
+	};
+
+	// expected score against an opponent who is elo points weaker, and its inverse
+	double scoreFromElo(double elo);
+	double eloFromScore(double score);
+
+	// elo difference implied by the results, with the half width of its 95% confidence interval
+	double elo(const Results& results, double* margin = nullptr);
+
+	/**
+		sequential probability ratio test of H0: elo = elo0 against H1: elo = elo1, using the normal approximation
+		of the log likelihood ratio over game scores. alpha and beta are the false positive and false negative rates.
+	*/
+	class SPRT {
+	public:
+		SPRT(double elo0, double elo1, double alpha = 0.05, double beta = 0.05);
+
+		void add(int result) { _results.add(result); }
+		const Results& results() const { return _results; }
+
+		double llr() const;
+		double lowerBound() const { return _lower; }
+		double upperBound() const { return _upper; }
+
+		// +1 once H1 is accepted, -1 once H0 is accepted, 0 while more games are needed
+		int status() const;
+
+	private:
+		Results _results;
+		double _score0;
+		double _score1;
+		double _lower;
+		double _upper;
+	};
+}
+
+#endif
@@ -0,0 +1,125 @@
+#include <unordered_map>
+
+#include "symmetry.h"
+#include "movegen.h"
+
+namespace symmetry {
+	struct Tables {
+		int squares[COUNT][Board::SQUARES];
+		int inverse[COUNT];
+		std::vector<uint32_t> moves[COUNT];
+
+		// packs everything that identifies a move into one key
+		static uint64_t key(const MoveInternal& move) {
+			uint64_t key = move.type | (move.position << 2) | (move.piece << 8) | (move.split_count << 10);
+			if (move.split_count > 0) key |= (uint64_t) move.split_positions[0] << 14;
+			for (int i = 0; i < move.split_count; ++i)
+				key |= (uint64_t) move.split_sizes[i] << (20 + 4 * i);
+			return key;
+		}
+
+		Tables() {
+			const int n = Board::SIZE - 1;
+			for (int sym = 0; sym < COUNT; ++sym) {
+				for (int y = 0; y < Board::SIZE; ++y) {
+					for (int x = 0; x < Board::SIZE; ++x) {
+						int tx = (sym & 4) ? y : x;
+						int ty = (sym & 4) ? x : y;
+						if (sym & 1) tx = n - tx;
+						if (sym & 2) ty = n - ty;
+						squares[sym][INDEX_BOARD(x, y)] = INDEX_BOARD(tx, ty);
+					}
+				}
+			}
+
+			for (int sym = 0; sym < COUNT; ++sym) {
+				for (int other = 0; other < COUNT; ++other) {
+					bool identity = true;
+					for (int i = 0; i < Board::SQUARES; ++i)
+						identity &= squares[other][squares[sym][i]] == i;
+					if (identity) inverse[sym] = other;
+				}
+			}
+
+			std::unordered_map<uint64_t, uint32_t> ids;
+			for (const MoveInternal& move : movegen::all_moves)
+				ids[key(move)] = move.moveid;
+
+			for (int sym = 0; sym < COUNT; ++sym) {
+				moves[sym].resize(movegen::all_moves.size());
+				for (const MoveInternal& move : movegen::all_moves) {
+					MoveInternal mapped = move;
+					mapped.position = squares[sym][move.position];
+					for (int i = 0; i < move.split_count; ++i)
+						mapped.split_positions[i] = squares[sym][move.split_positions[i]];
+					assert(ids.count(key(mapped)));
+					moves[sym][move.moveid] = ids[key(mapped)];
+				}
+			}
+		}
+	};
+
+	// NOTE: built on first use, the move tables need movegen's static initialization to have run
+	static const Tables& tables() {
+		static const Tables tables;
+		return tables;
+	}
+
+	int square(int sym, int square) {
+		return tables().squares[sym][square];
+	}
+
+	int inverse(int sym) {
+		return tables().inverse[sym];
+	}
+
+	void transform(const Board& board, int sym, Board* result) {
+		const int* squares = tables().squares[sym];
+		*result = board;
+		for (int i = 0; i < Board::SQUARES; ++i)
+			result->stacks[squares[i]] = board.stacks[i];
+	}
+
+	uint32_t transformMove(int sym, uint32_t moveid) {
+		return tables().moves[sym][moveid];
+	}
+
+	uint64_t canonicalHash(const Board& board, int* sym) {
+		uint64_t best = board.hash();
+		int bestSym = 0;
+		Board transformed;
+		for (int s = 1; s < COUNT; ++s) {
+			transform(board, s, &transformed);
+			const uint64_t hash = transformed.hash();
+			if (hash < best) {
+				best = hash;
+				bestSym = s;
+			}
+		}
+		if (sym) *sym = bestSym;
+		return best;
+	}
+
+	void pruneSymmetricMoves(const Board& board, std::vector<Move>* moves) {
+		int stabilizers[COUNT];
+		int count = 0;
+		Board transformed;
+		for (int s = 1; s < COUNT; ++s) {
+			transform(board, s, &transformed);
+			if (transformed == board) stabilizers[count++] = s;
+		}
+		// NOTE: past the first few plies boards are almost never symmetric
+		if (count == 0) return;
+
+		const Tables& t = tables();
+		size_t kept = 0;
+		for (size_t i = 0; i < moves->size(); ++i) {
+			const uint32_t moveid = (*moves)[i].moveid;
+			bool representative = true;
+			for (int j = 0; j < count && representative; ++j)
+				representative = t.moves[stabilizers[j]][moveid] >= moveid;
+			if (representative) (*moves)[kept++] = (*moves)[i];
+		}
+		moves->resize(kept);
+	}
+}
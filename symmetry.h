@@ -0,0 +1,32 @@
+#ifndef __SYMMETRY_H_
+#define __SYMMETRY_H_
+
+#include <stdint.h>
+#include <vector>
+
+#include "board.h"
+
+/**
+	the 8 symmetries of the square board (rotations and reflections) acting on squares, boards and moveids.
+
+	symmetry s maps (x, y) by first swapping x and y if bit 2 is set, then mirroring x if bit 0 is set and y if bit 1
+	is set. symmetry 0 is the identity.
+*/
+
+namespace symmetry {
+	const int COUNT = 8;
+
+	int square(int sym, int square);
+	int inverse(int sym);
+
+	void transform(const Board& board, int sym, Board* result);
+	uint32_t transformMove(int sym, uint32_t moveid);
+
+	// the smallest hash over all orientations of the board, sym is set to the symmetry that produces it
+	uint64_t canonicalHash(const Board& board, int* sym = nullptr);
+
+	// drops moves that lead to the same position as a lower moveid by a symmetry of the board
+	void pruneSymmetricMoves(const Board& board, std::vector<Move>* moves);
+}
+
+#endif
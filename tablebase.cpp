@@ -0,0 +1,501 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+#include "tablebase.h"
+#include "movegen.h"
+
+namespace tablebase {
+	// every position in a table has its move number set to this, past the opening it changes nothing else
+	const int MOVENO = 2;
+
+	// positions expanded at once when collecting the table
+	const size_t BATCH = 4096;
+
+	// steps of the retrograde analysis over fewer positions than this are not worth starting threads for
+	const size_t PARALLEL_MINIMUM = 1024;
+
+	// a successor that is not in the table, and game overs that are not, lost or won by the side to move in them
+	const uint32_t NONE = UINT32_MAX;
+	const uint32_t WON = UINT32_MAX - 1;
+	const uint32_t LOST = UINT32_MAX - 2;
+
+	static inline uint16_t encode(Result result, int distance) {
+		return (uint16_t)(result << RESULT_SHIFT | std::min(distance, MAX_DISTANCE));
+	}
+
+	static inline Probe decode(uint16_t value) {
+		Probe probe;
+		probe.result = (Result)(value >> RESULT_SHIFT);
+		probe.distance = value & MAX_DISTANCE;
+		return probe;
+	}
+
+	const char* resultString(Result result) {
+		switch (result) {
+			case WIN: return "win";
+			case LOSS: return "loss";
+			case DRAW: return "draw";
+			default: return "unknown";
+		}
+	}
+
+	template<int N>
+	uint64_t key(const BoardT<N>& board) {
+		BoardT<N> copy = board;
+		copy.moveno = MOVENO;
+		return copy.hash();
+	}
+
+	template<int N>
+	Generator<N>::Generator(unsigned long maxPositions, int threads) : _maxPositions(maxPositions), _threads(std::max(1, threads)) { }
+
+	template<int N>
+	template<typename F>
+	void Generator<N>::parallel(size_t count, F body, size_t minimum) const {
+		if (_threads == 1 || count < minimum) {
+			body(0, count);
+			return ;
+		}
+		const size_t chunk = (count + _threads - 1) / _threads;
+		std::vector<std::thread> pool;
+		for (size_t begin = 0; begin < count; begin += chunk)
+			pool.push_back(std::thread(body, begin, std::min(count, begin + chunk)));
+		for (std::thread& thread : pool)
+			thread.join();
+	}
+
+	template<int N>
+	bool Generator<N>::insert(const BoardT<N>& board, uint64_t key) {
+		if (full() || _index.count(key)) return false;
+		_index[key] = _boards.size();
+		_boards.push_back(board);
+		_keys.push_back(key);
+		return true;
+	}
+
+	template<int N>
+	bool Generator<N>::add(const BoardT<N>& board) {
+		if (board.moveno < MOVENO || full()) return false;
+		BoardT<N> copy = board;
+		copy.moveno = MOVENO;
+		insert(copy, copy.hash());
+		return true;
+	}
+
+	template<int N>
+	void Generator<N>::expand() {
+		while (_expanded < _boards.size() && !full()) {
+			const size_t begin = _expanded;
+			const size_t end = std::min(_boards.size(), begin + BATCH);
+
+			// NOTE: successors are generated and hashed in parallel, only inserting them is serial
+			std::vector<std::vector<std::pair<uint64_t, BoardT<N>>>> found(end - begin);
+			parallel(end - begin, [&](size_t from, size_t to) {
+				for (size_t i = from; i < to; ++i) {
+					const BoardT<N>& board = _boards[begin + i];
+					if (board.getWinner() != 0) continue;
+					for (const Move& move : board.get_moves()) {
+						BoardT<N> next = board;
+						move.apply(next);
+						next.moveno = MOVENO;
+						found[i].push_back(std::make_pair(next.hash(), next));
+					}
+				}
+			});
+
+			for (const auto& successors : found) {
+				for (const auto& next : successors)
+					insert(next.second, next.first);
+			}
+			_expanded = end;
+		}
+	}
+
+	template<int N>
+	void Generator<N>::linkSuccessors() {
+		const size_t count = _boards.size();
+		_offsets.assign(count + 1, 0);
+		parallel(count, [&](size_t from, size_t to) {
+			for (size_t i = from; i < to; ++i) {
+				if (_boards[i].getWinner() == 0) _offsets[i + 1] = _boards[i].count_moves();
+			}
+		});
+		for (size_t i = 0; i < count; ++i)
+			_offsets[i + 1] += _offsets[i];
+
+		_successors.assign(_offsets[count], NONE);
+		parallel(count, [&](size_t from, size_t to) {
+			for (size_t i = from; i < to; ++i) {
+				if (_offsets[i] == _offsets[i + 1]) continue;
+				uint64_t edge = _offsets[i];
+				for (const Move& move : _boards[i].get_moves()) {
+					BoardT<N> next = _boards[i];
+					move.apply(next);
+					next.moveno = MOVENO;
+					auto it = _index.find(next.hash());
+					// NOTE: the fastest wins end the game, they are known even when the table was full before reaching them
+					const int winner = next.getWinner();
+					if (it != _index.end()) _successors[edge++] = it->second;
+					else if (winner != 0) _successors[edge++] = winner == next.playerTurn ? WON : LOST;
+					else _successors[edge++] = NONE;
+				}
+			}
+		});
+	}
+
+	template<int N>
+	void Generator<N>::solve() {
+		linkSuccessors();
+		_values.assign(_boards.size(), encode(UNKNOWN, 0));
+
+		// NOTE: reserves only go down, so slices with fewer pieces left are solved first
+		auto reserves = [this](uint32_t i) {
+			const BoardT<N>& board = _boards[i];
+			const uint32_t total = board.piecesleft[0] + board.piecesleft[1] + board.capstones[0] + board.capstones[1];
+			return (uint64_t)total << 32 | board.piecesleft[0] << 16 | board.piecesleft[1] << 8
+				| board.capstones[0] << 4 | board.capstones[1];
+		};
+		std::vector<uint32_t> order(_boards.size());
+		for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+		std::sort(order.begin(), order.end(), [&reserves](uint32_t a, uint32_t b) {
+			return reserves(a) < reserves(b);
+		});
+
+		std::vector<uint32_t> local(_boards.size(), NONE);
+		std::vector<uint32_t> slice;
+		for (size_t i = 0; i < order.size(); ++i) {
+			slice.push_back(order[i]);
+			if (i + 1 == order.size() || reserves(order[i + 1]) != reserves(order[i])) {
+				solveSlice(slice, local);
+				slice.clear();
+			}
+		}
+
+		// the links are only needed while solving
+		std::vector<uint64_t>().swap(_offsets);
+		std::vector<uint32_t>().swap(_successors);
+	}
+
+	template<int N>
+	void Generator<N>::solveSlice(const std::vector<uint32_t>& slice, std::vector<uint32_t>& local) {
+		const uint8_t BLOCKED = 1; // some move does not lose, the position cannot be a loss
+		const uint8_t OPEN = 2; // some line leaves the table, the position cannot be a draw
+
+		struct Proven {
+			uint32_t i;
+			Result result;
+			int distance;
+		};
+
+		const size_t count = slice.size();
+		for (size_t i = 0; i < count; ++i) local[slice[i]] = i;
+
+		// NOTE: the counters are shared between the threads, a position is solved by the thread that claims it first
+		std::vector<std::atomic<uint32_t>> remaining(count); // moves inside the slice not yet proven to lose
+		std::vector<std::atomic<int>> longest(count); // the longest win of the opponent after our moves
+		std::vector<std::atomic<uint8_t>> solved(count);
+		std::vector<std::atomic<uint32_t>> fill(count); // predecessors counted, then where the next one goes
+		std::vector<uint8_t> flags(count, 0);
+		std::vector<std::vector<std::pair<uint32_t, Result>>> buckets; // proven results by distance
+
+		std::mutex mutex;
+		auto push = [&buckets, &mutex](const std::vector<Proven>& proven) {
+			std::lock_guard<std::mutex> lock(mutex);
+			for (const Proven& entry : proven) {
+				const int distance = std::min(entry.distance, MAX_DISTANCE);
+				if ((int)buckets.size() <= distance) buckets.resize(distance + 1);
+				buckets[distance].push_back(std::make_pair(entry.i, entry.result));
+			}
+		};
+
+		parallel(count, [&](size_t from, size_t to) {
+			std::vector<Proven> proven;
+			for (size_t i = from; i < to; ++i) {
+				const BoardT<N>& board = _boards[slice[i]];
+				const int winner = board.getWinner();
+				if (winner != 0) {
+					proven.push_back({(uint32_t)i, winner == board.playerTurn ? WIN : LOSS, 0});
+					continue;
+				}
+
+				const uint64_t begin = _offsets[slice[i]];
+				const uint64_t end = _offsets[slice[i] + 1];
+				// NOTE: a side that cannot move has not lost either
+				if (begin == end) {
+					_values[slice[i]] = encode(DRAW, 0);
+					solved[i] = 1;
+					continue;
+				}
+
+				int shortest = -1;
+				int slowest = 0;
+				uint32_t inside = 0;
+				for (uint64_t edge = begin; edge < end; ++edge) {
+					const uint32_t next = _successors[edge];
+					if (next == NONE) {
+						flags[i] |= BLOCKED | OPEN;
+					} else if (next == LOST) {
+						// NOTE: a winning move does not lose either, whatever the spreads inside the slice turn out to be
+						shortest = 0;
+						flags[i] |= BLOCKED;
+					} else if (next == WON) {
+						continue;
+					} else if (local[next] != NONE) {
+						inside++;
+						fill[local[next]]++;
+					} else {
+						// solved with an earlier slice
+						const Probe probe = decode(_values[next]);
+						if (probe.result == LOSS) {
+							shortest = shortest < 0 ? probe.distance : std::min(shortest, probe.distance);
+							flags[i] |= BLOCKED;
+						} else if (probe.result == WIN) slowest = std::max(slowest, probe.distance);
+						else if (probe.result == DRAW) flags[i] |= BLOCKED;
+						else flags[i] |= BLOCKED | OPEN;
+					}
+				}
+				remaining[i] = inside;
+				longest[i] = slowest;
+				if (shortest >= 0) proven.push_back({(uint32_t)i, WIN, shortest + 1});
+				else if (inside == 0 && !(flags[i] & BLOCKED)) proven.push_back({(uint32_t)i, LOSS, slowest + 1});
+			}
+			push(proven);
+		}, PARALLEL_MINIMUM);
+
+		std::vector<uint32_t> predecessorOffsets(count + 1, 0);
+		for (size_t i = 0; i < count; ++i) {
+			predecessorOffsets[i + 1] = predecessorOffsets[i] + fill[i];
+			fill[i] = predecessorOffsets[i];
+		}
+		std::vector<uint32_t> predecessors(predecessorOffsets[count]);
+		parallel(count, [&](size_t from, size_t to) {
+			for (size_t i = from; i < to; ++i) {
+				if (_boards[slice[i]].getWinner() != 0) continue;
+				for (uint64_t edge = _offsets[slice[i]]; edge < _offsets[slice[i] + 1]; ++edge) {
+					const uint32_t next = _successors[edge];
+					if (next < LOST && local[next] != NONE) predecessors[fill[local[next]]++] = i;
+				}
+			}
+		}, PARALLEL_MINIMUM);
+
+		// NOTE: results are proven in order of distance, so the first one a position gets is its fastest win. every
+		// result proven from a bucket lands in a later one, except at the largest distance, so the positions of a
+		// bucket are independent and the threads split it. which thread claims a position changes nothing stored
+		for (size_t distance = 0; distance < buckets.size(); ++distance) {
+			while (!buckets[distance].empty()) {
+				std::vector<std::pair<uint32_t, Result>> bucket;
+				bucket.swap(buckets[distance]);
+
+				parallel(bucket.size(), [&](size_t from, size_t to) {
+					std::vector<Proven> proven;
+					for (size_t k = from; k < to; ++k) {
+						const uint32_t i = bucket[k].first;
+						const Result result = bucket[k].second;
+						uint8_t unsolved = 0;
+						if (!solved[i].compare_exchange_strong(unsolved, 1)) continue;
+						_values[slice[i]] = encode(result, distance);
+
+						for (uint32_t p = predecessorOffsets[i]; p < predecessorOffsets[i + 1]; ++p) {
+							const uint32_t previous = predecessors[p];
+							if (solved[previous]) continue;
+							if (result == LOSS) {
+								proven.push_back({previous, WIN, (int)distance + 1});
+							} else {
+								// NOTE: raised before the count goes down, the thread taking it to zero sees every raise
+								int seen = longest[previous];
+								while (seen < (int)distance && !longest[previous].compare_exchange_weak(seen, distance)) { }
+								if (--remaining[previous] == 0 && !(flags[previous] & BLOCKED))
+									proven.push_back({previous, LOSS, longest[previous] + 1});
+							}
+						}
+					}
+					push(proven);
+				}, PARALLEL_MINIMUM);
+			}
+			std::vector<std::pair<uint32_t, Result>>().swap(buckets[distance]);
+		}
+
+		// whatever can reach a way out of the table is unknown, the rest is drawn
+		std::vector<uint32_t> open;
+		for (size_t i = 0; i < count; ++i) {
+			if (!solved[i] && (flags[i] & OPEN)) open.push_back(i);
+		}
+		while (!open.empty()) {
+			const uint32_t i = open.back();
+			open.pop_back();
+			for (uint32_t p = predecessorOffsets[i]; p < predecessorOffsets[i + 1]; ++p) {
+				const uint32_t previous = predecessors[p];
+				if (solved[previous] || (flags[previous] & OPEN)) continue;
+				flags[previous] |= OPEN;
+				open.push_back(previous);
+			}
+		}
+		for (size_t i = 0; i < count; ++i) {
+			if (!solved[i] && !(flags[i] & OPEN)) _values[slice[i]] = encode(DRAW, 0);
+		}
+
+		for (size_t i = 0; i < count; ++i) local[slice[i]] = NONE;
+	}
+
+	template<int N>
+	size_t Generator<N>::count(Result result) const {
+		size_t count = 0;
+		for (uint16_t value : _values) {
+			if (decode(value).result == result) count++;
+		}
+		return count;
+	}
+
+	template<int N>
+	size_t Generator<N>::check() const {
+		std::atomic<size_t> wrong(0);
+		parallel(_boards.size(), [&](size_t from, size_t to) {
+			for (size_t i = from; i < to; ++i) {
+				const Probe probe = decode(_values[i]);
+				if (probe.result != WIN && probe.result != LOSS) continue;
+
+				const BoardT<N>& board = _boards[i];
+				const int winner = board.getWinner();
+				if (winner != 0) {
+					if (probe.result != (winner == board.playerTurn ? WIN : LOSS) || probe.distance != 0) wrong++;
+					continue;
+				}
+
+				// a win needs a move to a loss one ply closer, a loss needs every move to a win and the slowest one a
+				// ply closer
+				bool found = false;
+				bool agrees = true;
+				for (const Move& move : board.get_moves()) {
+					BoardT<N> next = board;
+					move.apply(next);
+					next.moveno = MOVENO;
+					Probe reply;
+					const int over = next.getWinner();
+					if (over != 0) {
+						reply.result = over == next.playerTurn ? WIN : LOSS;
+					} else {
+						auto it = _index.find(next.hash());
+						if (it != _index.end()) reply = decode(_values[it->second]);
+					}
+
+					if (probe.result == WIN) {
+						found |= reply.result == LOSS && reply.distance + 1 == probe.distance;
+					} else {
+						agrees &= reply.result == WIN && reply.distance + 1 <= probe.distance;
+						found |= reply.result == WIN && reply.distance + 1 == probe.distance;
+					}
+				}
+				// NOTE: distances past the largest one stored are clamped to it
+				if (probe.distance < MAX_DISTANCE && !(found && agrees)) wrong++;
+			}
+		}, PARALLEL_MINIMUM);
+		return wrong;
+	}
+
+	template<int N>
+	bool Generator<N>::write(const std::string& path) const {
+		std::vector<uint32_t> stored;
+		for (size_t i = 0; i < _values.size(); ++i) {
+			if (decode(_values[i]).result != UNKNOWN) stored.push_back(i);
+		}
+		std::sort(stored.begin(), stored.end(), [this](uint32_t a, uint32_t b) {
+			return _keys[a] < _keys[b];
+		});
+
+		std::vector<uint64_t> keys;
+		std::vector<uint16_t> values;
+		keys.reserve(stored.size());
+		values.reserve(stored.size());
+		for (uint32_t i : stored) {
+			keys.push_back(_keys[i]);
+			values.push_back(_values[i]);
+		}
+
+		FILE *file = fopen(path.c_str(), "wb");
+		if (!file) return false;
+		record::FileHeader fileHeader = {MAGIC, record::VERSION};
+		Header header = {N, 0, keys.size()};
+		bool ok = fwrite(&fileHeader, sizeof(fileHeader), 1, file) == 1 && fwrite(&header, sizeof(header), 1, file) == 1;
+		if (ok && !keys.empty()) {
+			ok = fwrite(keys.data(), sizeof(uint64_t), keys.size(), file) == keys.size()
+				&& fwrite(values.data(), sizeof(uint16_t), values.size(), file) == values.size();
+		}
+		return fclose(file) == 0 && ok;
+	}
+
+	bool Table::open(const std::string& path) {
+		_header = nullptr;
+		if (!_file.open(path, MAGIC) || _file.size() < sizeof(Header)) return false;
+
+		const Header* header = (const Header*) _file.data();
+		if (_file.size() != sizeof(Header) + header->count * (sizeof(uint64_t) + sizeof(uint16_t))) {
+			_file.close();
+			return false;
+		}
+		_header = header;
+		_keys = (const uint64_t*)(_file.data() + sizeof(Header));
+		_values = (const uint16_t*)(_keys + header->count);
+		return true;
+	}
+
+	template<int N>
+	Probe Table::probe(const BoardT<N>& board) const {
+		if (!_header || _header->size != N || board.moveno < MOVENO) return Probe();
+
+		const uint64_t hash = key(board);
+		const uint64_t* end = _keys + _header->count;
+		const uint64_t* it = std::lower_bound(_keys, end, hash);
+		if (it == end || *it != hash) return Probe();
+		return decode(_values[it - _keys]);
+	}
+
+	template<int N>
+	bool Table::bestMove(const BoardT<N>& board, Move* move, Probe* result) const {
+		const Probe probe = this->probe(board);
+		if (result) *result = probe;
+		if (probe.result == UNKNOWN || board.getWinner() != 0) return false;
+
+		bool found = false;
+		int best = 0;
+		for (const Move& candidate : board.get_moves()) {
+			BoardT<N> next = board;
+			candidate.apply(next);
+			const int winner = next.getWinner();
+			Probe reply = this->probe(next);
+			if (winner != 0) {
+				reply.result = winner == next.playerTurn ? WIN : LOSS;
+				reply.distance = 0;
+			}
+
+			// the opponent's result after the move, fastest win first and slowest loss when every move loses
+			int score;
+			if (reply.result == LOSS) score = 3 * MAX_DISTANCE - reply.distance;
+			else if (reply.result == DRAW) score = MAX_DISTANCE;
+			else if (reply.result == WIN) score = reply.distance;
+			else continue;
+
+			if (!found || score > best) {
+				*move = candidate;
+				best = score;
+				found = true;
+			}
+		}
+		return found;
+	}
+
+#define INSTANTIATE_TABLEBASE(N) \
+	template uint64_t key<N>(const BoardT<N>& board); \
+	template class Generator<N>; \
+	template Probe Table::probe<N>(const BoardT<N>& board) const; \
+	template bool Table::bestMove<N>(const BoardT<N>& board, Move* move, Probe* result) const;
+
+	INSTANTIATE_TABLEBASE(3)
+	INSTANTIATE_TABLEBASE(4)
+	INSTANTIATE_TABLEBASE(5)
+	INSTANTIATE_TABLEBASE(6)
+	INSTANTIATE_TABLEBASE(7)
+	INSTANTIATE_TABLEBASE(8)
+}
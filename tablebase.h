@@ -0,0 +1,130 @@
+#ifndef __TABLEBASE_H_
+#define __TABLEBASE_H_
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "board.h"
+#include "record.h"
+
+/**
+	retrograde tablebases. the generator collects every position reachable from a set of root positions, up to a
+	limit, and solves them slice by slice in order of the pieces left in the reserves: a placement always lands in a
+	solved slice and only spreads stay inside one, so each slice is a small retrograde analysis of its own. a position
+	is a win or loss once proven from its successors, and a draw if neither side can force a result and every line
+	from it stays inside the table. positions that could leave the table unproven are left out, every result stored
+	is exact and checked against the successors before the table is written. the distance is exact too when the
+	table holds every position reachable from its roots, otherwise the winner following the table wins within that
+	many plies but a shorter win may pass through a missing position.
+
+	the file holds the keys sorted followed by a value per key, the engine maps it and binary searches the keys. the
+	stones of the opening are placed for the opponent, those positions are never in a table.
+*/
+
+namespace tablebase {
+	const uint32_t MAGIC = 0x42544b54; // "TKTB"
+
+	const unsigned long DEFAULT_MAX_POSITIONS = 4000000;
+
+	enum Result : uint8_t {
+		UNKNOWN = 0,
+		WIN,
+		LOSS,
+		DRAW,
+	};
+
+	const char* resultString(Result result);
+
+	// NOTE: the result is in the top 2 bits of a value, the distance in plies to the end of the game in the rest
+	const int RESULT_SHIFT = 14;
+	const int MAX_DISTANCE = (1 << RESULT_SHIFT) - 1;
+
+	struct Header {
+		uint32_t size;
+		uint32_t reserved;
+		uint64_t count;
+	};
+	static_assert(sizeof(Header) == 16, "tablebase headers should stay 16 bytes");
+
+	// for the side to move, with best play the winner ends the game as soon as it can and the loser as late
+	struct Probe {
+		Result result = UNKNOWN;
+		int distance = 0;
+	};
+
+	// the position hash the table is keyed by, the same for every move number past the opening
+	template<int N> uint64_t key(const BoardT<N>& board);
+
+	template<int N>
+	class Generator {
+	public:
+		Generator(unsigned long maxPositions = DEFAULT_MAX_POSITIONS, int threads = 1);
+
+		// queues a root position, returns false if it is in the opening or the table is full
+		bool add(const BoardT<N>& board);
+
+		// collects every position reachable from the roots until the table is full
+		void expand();
+
+		void solve();
+
+		bool write(const std::string& path) const;
+
+		size_t size() const { return _boards.size(); }
+		bool full() const { return _boards.size() >= _maxPositions; }
+
+		// positions with the result after solve
+		size_t count(Result result) const;
+
+		// positions whose stored win or loss disagrees with the results of their successors, 0 after a sound solve
+		size_t check() const;
+
+	private:
+		std::vector<BoardT<N>> _boards;
+		std::vector<uint64_t> _keys;
+		std::unordered_map<uint64_t, uint32_t> _index;
+		size_t _expanded = 0;
+
+		// successors of position i are _successors[_offsets[i]] up to _offsets[i + 1], NONE where they left the table
+		std::vector<uint64_t> _offsets;
+		std::vector<uint32_t> _successors;
+		std::vector<uint16_t> _values;
+
+		unsigned long _maxPositions;
+		int _threads;
+
+		bool insert(const BoardT<N>& board, uint64_t key);
+		void linkSuccessors();
+		void solveSlice(const std::vector<uint32_t>& slice, std::vector<uint32_t>& local);
+
+		// runs body(begin, end) over the range split between the threads, on the calling thread if the range is
+		// shorter than the minimum
+		template<typename F> void parallel(size_t count, F body, size_t minimum = 1) const;
+	};
+
+	class Table {
+	public:
+		bool open(const std::string& path);
+
+		// the board size the table was generated for
+		int boardSize() const { return _header ? _header->size : 0; }
+		size_t size() const { return _header ? _header->count : 0; }
+
+		// UNKNOWN for positions not in the table and boards of another size
+		template<int N> Probe probe(const BoardT<N>& board) const;
+
+		// the move keeping the best result, the fastest win, slowest loss or a draw. returns false if the position
+		// is not in the table
+		template<int N> bool bestMove(const BoardT<N>& board, Move* move, Probe* probe = nullptr) const;
+
+	private:
+		record::MappedFile _file;
+		const Header* _header = nullptr;
+		const uint64_t* _keys = nullptr;
+		const uint16_t* _values = nullptr;
+	};
+}
+
+#endif
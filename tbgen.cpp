@@ -0,0 +1,246 @@
+#include <unistd.h>
+#include <chrono>
+#include <random>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "board.h"
+#include "movegen.h"
+#include "player.h"
+#include "tablebase.h"
+
+/**
+	builds a tablebase from random games, or probes one with TBG encoded boards read from stdin. the roots are the
+	first positions of the games where a side is down to the given reserve, the table holds everything reachable
+	from them.
+
+	a table can also score the minmax search on the board size it was built for: the roots are found again from the
+	same games, positions are sampled by random walks inside the table from them, and the move the search picks
+	without the table is checked to keep the result the table has for the position.
+*/
+
+typedef std::chrono::steady_clock Clock;
+
+struct GeneratorOptions {
+	int size = 3;
+	int reserve = 2;
+	int roots = 1000;
+	unsigned long maxPositions = tablebase::DEFAULT_MAX_POSITIONS;
+	int threads = 1;
+	bool probe = false;
+	int accuracyDepth = 0;
+};
+
+static void usage(const char *name) {
+	std::cerr << "usage: " << name << " [options] <table>\n"
+		"\t-s SIZE     board size from 3 to 8 (default 3)\n"
+		"\t-r RESERVE  roots are taken once a side has this many pieces or fewer left to place (default 2)\n"
+		"\t-n ROOTS    random games to take roots from (default 1000)\n"
+		"\t-m COUNT    positions in the table at most (default 4000000)\n"
+		"\t-j THREADS  threads to generate and solve with (default: one per core)\n"
+		"\t-p          probe the table with TBG boards from stdin instead, printing the result, distance and best move\n"
+		"\t-a DEPTH    score the minmax search at the depth against the table instead, on random walks from the roots\n"
+		"\t            of the table, -r and -n must be the ones it was built with\n";
+}
+
+static double elapsed(Clock::time_point start) {
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// the first position of random game number i where a side is down to the reserve, false if the game ends before.
+// NOTE: every game has a seed of its own so the accuracy mode finds the roots of a table again
+template<int N>
+static bool randomRoot(int i, int reserve, BoardT<N>* board) {
+	std::minstd_rand random(i + 1);
+	while (board->getWinner() == 0) {
+		if (board->moveno >= 2 && (board->piecesleft[0] <= reserve || board->piecesleft[1] <= reserve)) return true;
+		std::vector<Move> moves = board->get_moves();
+		if (moves.empty()) return false;
+		moves[random() % moves.size()].apply(*board);
+	}
+	return false;
+}
+
+template<int N>
+static int generate(const GeneratorOptions& options, const std::string& path) {
+	Clock::time_point start = Clock::now();
+	tablebase::Generator<N> generator(options.maxPositions, options.threads);
+
+	int roots = 0;
+	for (int i = 0; i < options.roots && !generator.full(); ++i) {
+		BoardT<N> board;
+		if (randomRoot(i, options.reserve, &board) && generator.add(board)) roots++;
+	}
+	generator.expand();
+	std::cout << roots << " roots, " << generator.size() << " positions" << (generator.full() ? " (full)" : "")
+		<< " in " << elapsed(start) << "s" << std::endl;
+
+	start = Clock::now();
+	generator.solve();
+	std::cout << "solved in " << elapsed(start) << "s:";
+	const tablebase::Result results[] = {tablebase::WIN, tablebase::LOSS, tablebase::DRAW, tablebase::UNKNOWN};
+	for (tablebase::Result result : results)
+		std::cout << " " << generator.count(result) << " " << tablebase::resultString(result);
+	std::cout << std::endl;
+
+	const size_t wrong = generator.check();
+	if (wrong > 0) {
+		std::cerr << wrong << " results disagree with their successors, not writing " << path << std::endl;
+		return 1;
+	}
+
+	if (!generator.write(path)) {
+		std::cerr << "failed to write " << path << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+template<int N>
+static int probe(const tablebase::Table& table) {
+	std::string line;
+	while (std::getline(std::cin, line)) {
+		if (line.empty() || line[0] == '#') continue;
+		BoardT<N> board;
+		typename BoardT<N>::TBGError error = BoardT<N>::parseTBG(line.c_str(), line.length(), &board);
+		if (error != BoardT<N>::TBG_OK) {
+			std::cout << BoardT<N>::tbgErrorString(error) << std::endl;
+			continue;
+		}
+
+		Move move;
+		tablebase::Probe result;
+		if (table.bestMove(board, &move, &result)) {
+			move.apply(board);
+			std::cout << tablebase::resultString(result.result) << " " << result.distance << " " << board.toTBGEncoding() << std::endl;
+		} else {
+			std::cout << tablebase::resultString(result.result) << std::endl;
+		}
+	}
+	return 0;
+}
+
+// the result of the side to move after the move, as the table or the end of the game has it
+template<int N>
+static tablebase::Result resultAfter(const tablebase::Table& table, const BoardT<N>& board, const Move& move) {
+	BoardT<N> next = board;
+	move.apply(next);
+	const int winner = next.getWinner();
+	if (winner != 0) return winner == board.playerTurn ? tablebase::WIN : tablebase::LOSS;
+	const tablebase::Result reply = table.probe(next).result;
+	if (reply == tablebase::WIN) return tablebase::LOSS;
+	if (reply == tablebase::LOSS) return tablebase::WIN;
+	return reply;
+}
+
+template<int N>
+static int accuracy(const GeneratorOptions& options, const tablebase::Table& table) {
+	// NOTE: the player is given no table, its own search is what is scored
+	MinmaxPlayer player(options.accuracyDepth);
+	player.verbose = false;
+
+	Clock::time_point start = Clock::now();
+	int tested[4] = {}; // by the result of the position
+	int kept[4] = {};
+	int unknown = 0; // moves into positions the table does not hold
+	for (int i = 0; i < options.roots; ++i) {
+		BoardT<N> board;
+		if (!randomRoot(i, options.reserve, &board)) continue;
+
+		// NOTE: the walk from the root only takes moves that stay in the table
+		while (board.getWinner() == 0) {
+			const tablebase::Result result = table.probe(board).result;
+			if (result == tablebase::UNKNOWN) break;
+
+			// every move of a lost position keeps the result, only wins and draws tell anything
+			if (result == tablebase::WIN || result == tablebase::DRAW) {
+				Move move;
+				player.minmax(board, options.accuracyDepth, &move);
+				const tablebase::Result after = resultAfter(table, board, move);
+				if (after == tablebase::UNKNOWN) {
+					unknown++;
+				} else {
+					tested[result]++;
+					// NOTE: a draw is kept by any move that does not lose
+					if (after == result || (result == tablebase::DRAW && after == tablebase::WIN)) kept[result]++;
+				}
+			}
+
+			std::vector<Move> moves;
+			for (const Move& move : board.get_moves()) {
+				if (resultAfter(table, board, move) != tablebase::UNKNOWN) moves.push_back(move);
+			}
+			if (moves.empty()) break;
+			moves[rand() % moves.size()].apply(board);
+		}
+	}
+
+	std::cout << "depth " << options.accuracyDepth << " in " << elapsed(start) << "s:";
+	const tablebase::Result results[] = {tablebase::WIN, tablebase::DRAW};
+	for (tablebase::Result result : results) {
+		std::cout << " " << tablebase::resultString(result) << " kept " << kept[result] << " of " << tested[result];
+		if (tested[result] > 0) std::cout << " (" << 100.0 * kept[result] / tested[result] << "%)";
+	}
+	std::cout << ", " << unknown << " moves left the table" << std::endl;
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	GeneratorOptions options;
+	options.threads = std::thread::hardware_concurrency();
+
+	int opt;
+	while ((opt = getopt(argc, argv, "s:r:n:m:j:pa:")) != -1) {
+		switch (opt) {
+			case 's': options.size = atoi(optarg); break;
+			case 'r': options.reserve = atoi(optarg); break;
+			case 'n': options.roots = atoi(optarg); break;
+			case 'm': options.maxPositions = strtoul(optarg, nullptr, 10); break;
+			case 'j': options.threads = atoi(optarg); break;
+			case 'p': options.probe = true; break;
+			case 'a': options.accuracyDepth = atoi(optarg); break;
+			default: usage(argv[0]); return 1;
+		}
+	}
+	if (argc - optind != 1 || options.size < 3 || options.size > 8) {
+		usage(argv[0]);
+		return 1;
+	}
+	const std::string path = argv[optind];
+
+	if (options.probe || options.accuracyDepth > 0) {
+		tablebase::Table table;
+		if (!table.open(path)) {
+			std::cerr << "failed to open " << path << std::endl;
+			return 1;
+		}
+		if (options.accuracyDepth > 0) {
+			switch (table.boardSize()) {
+				case 3: return accuracy<3>(options, table);
+				case 4: return accuracy<4>(options, table);
+				case 5: return accuracy<5>(options, table);
+				case 6: return accuracy<6>(options, table);
+				case 7: return accuracy<7>(options, table);
+				default: return accuracy<8>(options, table);
+			}
+		}
+		switch (table.boardSize()) {
+			case 3: return probe<3>(table);
+			case 4: return probe<4>(table);
+			case 5: return probe<5>(table);
+			case 6: return probe<6>(table);
+			case 7: return probe<7>(table);
+			default: return probe<8>(table);
+		}
+	}
+
+	switch (options.size) {
+		case 3: return generate<3>(options, path);
+		case 4: return generate<4>(options, path);
+		case 5: return generate<5>(options, path);
+		case 6: return generate<6>(options, path);
+		case 7: return generate<7>(options, path);
+		default: return generate<8>(options, path);
+	}
+}
@@ -0,0 +1,145 @@
+#include <unistd.h>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "board.h"
+#include "movegen.h"
+#include "playout.h"
+#include "proof.h"
+#include "threats.h"
+
+/**
+	benchmark of the threat space search on a suite of tactical positions, one TBG encoded board per line with the
+	side to move winning by force. every position is also given to the proof number search for comparison. the
+	suite can be generated from random games, keeping the positions where a threat sequence wins and no single move
+	does.
+*/
+
+typedef std::chrono::steady_clock Clock;
+
+static void usage(const char *name) {
+	std::cerr << "usage: " << name << " [options] <suite>\n"
+		"\t-d DEPTH    threats the search may make before the winning move (default 3)\n"
+		"\t-n NODES    node budget of the proof number search, 0 to skip it (default 100000)\n"
+		"\t-g COUNT    write COUNT tactical positions from random games to the suite instead\n";
+}
+
+static double elapsed(Clock::time_point start) {
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// the fewest threats that win the position, -1 if the search finds no win within depth
+static int threatsToWin(Board& board, int depth, unsigned long* nodes) {
+	for (int d = 0; d <= depth; ++d) {
+		if (threats::search(board, d, nullptr, nodes)) return d;
+	}
+	return -1;
+}
+
+static int generate(const std::string& path, int count, int depth) {
+	std::ofstream out(path);
+	if (!out) {
+		std::cerr << "failed to open " << path << std::endl;
+		return 1;
+	}
+
+	int found = 0;
+	unsigned long positions = 0;
+	while (found < count) {
+		Board board;
+		while (board.getWinner() == 0 && found < count) {
+			positions++;
+			if (threatsToWin(board, depth, nullptr) > 0) {
+				out << board.toTBGEncoding() << "\n";
+				found++;
+			}
+
+			uint32_t moveid;
+			if (!playout::randomMove(board, &moveid)) break;
+			movegen::all_moves[moveid].apply(board);
+		}
+	}
+	std::cout << found << " positions out of " << positions << " written to " << path << std::endl;
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	int depth = 3;
+	unsigned long proofNodes = 100000;
+	int count = 0;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "d:n:g:")) != -1) {
+		switch (opt) {
+			case 'd': depth = atoi(optarg); break;
+			case 'n': proofNodes = strtoul(optarg, nullptr, 10); break;
+			case 'g': count = atoi(optarg); break;
+			default: usage(argv[0]); return 1;
+		}
+	}
+	if (argc - optind != 1) {
+		usage(argv[0]);
+		return 1;
+	}
+	const std::string path = argv[optind];
+
+	if (count > 0) return generate(path, count, depth);
+
+	std::ifstream in(path);
+	if (!in) {
+		std::cerr << "failed to open " << path << std::endl;
+		return 1;
+	}
+
+	std::vector<Board> suite;
+	std::string line;
+	int lineno = 0;
+	while (std::getline(in, line)) {
+		lineno++;
+		if (line.empty() || line[0] == '#') continue;
+		Board board;
+		Board::TBGError error = Board::parseTBG(line.c_str(), line.length(), &board);
+		if (error != Board::TBG_OK) {
+			std::cerr << path << ":" << lineno << ": " << Board::tbgErrorString(error) << std::endl;
+			return 1;
+		}
+		suite.push_back(board);
+	}
+
+	int solved = 0;
+	int byDepth[16] = {0};
+	unsigned long nodes = 0;
+	Clock::time_point start = Clock::now();
+	for (Board& board : suite) {
+		const int d = threatsToWin(board, depth, &nodes);
+		if (d >= 0) {
+			solved++;
+			if (d < 16) byDepth[d]++;
+		}
+	}
+	const double seconds = elapsed(start);
+
+	std::cout << "threat space search: " << solved << "/" << suite.size() << " solved in " << seconds << "s, "
+		<< nodes << " nodes, " << (suite.empty() ? 0 : seconds * 1000 / suite.size()) << "ms per position" << std::endl;
+	for (int d = 0; d <= depth && d < 16; ++d)
+		std::cout << "\t" << d << " threats: " << byDepth[d] << std::endl;
+
+	if (proofNodes > 0) {
+		proof::Solver solver;
+		int proved = 0;
+		unsigned long proofTotal = 0;
+		start = Clock::now();
+		for (const Board& board : suite) {
+			proved += solver.findWin(board, proofNodes);
+			proofTotal += solver.nodes();
+		}
+		const double proofSeconds = elapsed(start);
+		std::cout << "proof number search: " << proved << "/" << suite.size() << " solved in " << proofSeconds << "s, "
+			<< proofTotal << " nodes, " << (suite.empty() ? 0 : proofSeconds * 1000 / suite.size()) << "ms per position"
+			<< std::endl;
+	}
+	return 0;
+}
@@ -0,0 +1,81 @@
+#include <algorithm>
+
+#include "threats.h"
+#include "movegen.h"
+
+namespace threats {
+	bool hasThreat(const Board& board, int player) {
+		const int reserve = player > 0 ? 0 : 1;
+		if (board.piecesleft[reserve] == 0 && board.capstones[reserve] == 0) return false;
+		return board.roadThreats(player) != 0;
+	}
+
+	bool immediateWin(Board& board, Move* win) {
+		// NOTE: the first two plies place the opponent's pieces
+		if (board.moveno < 2) return false;
+
+		const int team = board.playerTurn;
+		const int reserve = team > 0 ? 0 : 1;
+
+		const uint64_t squares = hasThreat(board, team) ? board.roadThreats(team) : 0;
+		if (squares != 0) {
+			const int piece = board.piecesleft[reserve] > 0 ? 0 : 2;
+			if (win) *win = Move(board.hash(), movegen::placements[__builtin_ctzll(squares)][piece].moveid);
+			return true;
+		}
+
+		// NOTE: a spread can complete a road too, and with the last flats any placement may win on flats
+		const bool lastFlats = board.piecesleft[0] <= 1 || board.piecesleft[1] <= 1;
+		for (const Move& move : board.get_moves()) {
+			if (!lastFlats && movegen::all_moves[move.moveid].type == MoveInternal::TYPE_PLACE) continue;
+			move.apply(board);
+			const int winner = board.getWinner();
+			move.revert(board);
+			if (winner == team) {
+				if (win) *win = move;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool defends(Board& board, int depth, unsigned long* nodes) {
+		const int defender = board.playerTurn;
+		for (const Move& move : board.get_moves()) {
+			move.apply(board);
+			const int winner = board.getWinner();
+			const bool holds = winner == defender || (winner == 0 && !search(board, depth, nullptr, nodes));
+			move.revert(board);
+			if (holds) return true;
+		}
+		return false;
+	}
+
+	bool search(Board& board, int depth, Move* win, unsigned long* nodes) {
+		if (nodes) (*nodes)++;
+		if (immediateWin(board, win)) return true;
+		if (depth == 0 || board.moveno < 2) return false;
+
+		const int team = board.playerTurn;
+		for (const Move& move : board.get_moves()) {
+			move.apply(board);
+			const bool forced = board.getWinner() == 0 && hasThreat(board, team) && !defends(board, depth - 1, nodes);
+			move.revert(board);
+			if (forced) {
+				if (win) *win = move;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void orderMoves(Board& board, std::vector<Move>* moves) {
+		const int team = board.playerTurn;
+		std::stable_partition(moves->begin(), moves->end(), [&](const Move& move) {
+			move.apply(board);
+			const bool forcing = board.getWinner() == team || hasThreat(board, team);
+			move.revert(board);
+			return forcing;
+		});
+	}
+}
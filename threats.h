@@ -0,0 +1,33 @@
+#ifndef __THREATS_H_
+#define __THREATS_H_
+
+#include <vector>
+
+#include "board.h"
+
+/**
+	threat space search for roads. the attacker only plays moves that leave it a placement completing a road, the
+	defender tries every reply. quiet attacking moves are never looked at, so long forcing sequences are found at a
+	fraction of the cost of a full search. a win it finds is a real forced win, a miss proves nothing
+*/
+
+namespace threats {
+	// the player could complete a road with its next placement, whoever is to move
+	bool hasThreat(const Board& board, int player);
+
+	// a move that wins on the spot for the side to move
+	bool immediateWin(Board& board, Move* win = nullptr);
+
+	// true if the side to move forces a win making at most depth threats before the winning move. nodes counts the
+	// positions visited when given
+	bool search(Board& board, int depth, Move* win = nullptr, unsigned long* nodes = nullptr);
+
+	// true if the side to move has a reply the opponent cannot win against making at most depth threats, with depth 0
+	// if the opponent cannot win on its next move
+	bool defends(Board& board, int depth = 0, unsigned long* nodes = nullptr);
+
+	// moves that win or threaten a road go first, the rest keep their order
+	void orderMoves(Board& board, std::vector<Move>* moves);
+}
+
+#endif
@@ -1,71 +1,371 @@
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
 #include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "board.h"
 
-void create_piped_proc(const char *fname, int *handles) {
-	int stdin[2];
-	int stdout[2];
-	pipe(stdin);
-	pipe(stdout);
-
-	int child = fork();
-	if (child == 0) {
-		close(stdin[1]);
-		close(stdout[0]);
-		dup2(stdin[0], 0);
-		dup2(stdout[1], 1);
-
-		execve(fname, NULL, NULL);
-	} else {
+/**
+	event driven tournament between external engine binaries.
+
+	every game runs two child processes which are sent a TBG encoded board on stdin whenever it is their turn and
+	answer with the TBG encoding of the board after their move. all running games are multiplexed over a single poll()
+	loop so a box can be saturated with matches without a thread per game.
+*/
+
+typedef std::chrono::steady_clock Clock;
+
+struct TournamentOptions {
+	std::string commands[2];
+	int games = 2;
+	int concurrency = 1;
+	int timeoutMs = 10000;
+	int maxPlies = 400;
+	int size = 5;
+	std::string recordFile;
+};
+
+/**
+	a child process speaking the engine protocol over a pair of pipes
+*/
+struct Engine {
+	pid_t pid = -1;
+	int in = -1; // the engine's stdin, positions are written here
+	int out = -1; // the engine's stdout, moves are read from here
+	std::string buffer;
+
+	~Engine() { stop(); }
+
+	bool start(const std::string& command) {
+		int stdin[2];
+		int stdout[2];
+		// NOTE: close on exec so engines of other games do not hold on to our pipes
+		if (pipe2(stdin, O_CLOEXEC) != 0) return false;
+		if (pipe2(stdout, O_CLOEXEC) != 0) {
+			close(stdin[0]);
+			close(stdin[1]);
+			return false;
+		}
+
+		pid = fork();
+		if (pid == 0) {
+			// NOTE: own process group so whatever the shell spawns is killed along with it
+			setpgid(0, 0);
+			dup2(stdin[0], 0);
+			dup2(stdout[1], 1);
+			execl("/bin/sh", "sh", "-c", command.c_str(), (char *)NULL);
+			_exit(127);
+		}
+
+		// NOTE: set on both sides so stop can kill the group even before the child gets to run, the call that
+		// comes second fails harmlessly
+		if (pid > 0) setpgid(pid, pid);
 		close(stdin[0]);
 		close(stdout[1]);
+		in = stdin[1];
+		out = stdout[0];
+		if (pid < 0) {
+			stop();
+			return false;
+		}
+		return true;
+	}
 
-		handles[0] = stdin[1];
-		handles[1] = stdout[0];
+	void stop() {
+		// NOTE: the pipes are closed first so a child that escaped the kill sees end of file instead of waiting on us
+		if (in >= 0) close(in);
+		if (out >= 0) close(out);
+		in = out = -1;
+		if (pid > 0) {
+			if (kill(-pid, SIGKILL) != 0) kill(pid, SIGKILL);
+			waitpid(pid, nullptr, 0);
+			pid = -1;
+		}
 	}
-}
 
-void read_until_newline(int fd, char *buffer) {
-	while (read(fd, buffer, 1)) {
-		if (*buffer == '\n') break ;
-		buffer++;
+	bool send(const std::string& line) {
+		// NOTE: anything left over is a reply to a position we no longer care about
+		buffer.clear();
+		size_t written = 0;
+		while (written < line.length()) {
+			ssize_t n = write(in, line.c_str() + written, line.length() - written);
+			if (n < 0 && errno == EINTR) continue;
+			if (n <= 0) return false;
+			written += n;
+		}
+		return true;
+	}
+
+	// reads whatever is available into the buffer, returns false once the engine has hung up
+	bool receive() {
+		char chunk[4096];
+		ssize_t n;
+		do {
+			n = read(out, chunk, sizeof(chunk));
+		} while (n < 0 && errno == EINTR);
+		if (n <= 0) return false;
+		buffer.append(chunk, n);
+		return true;
+	}
+
+	bool nextLine(std::string* line) {
+		size_t newline = buffer.find('\n');
+		if (newline == std::string::npos) return false;
+		*line = buffer.substr(0, newline);
+		buffer.erase(0, newline + 1);
+		if (!line->empty() && line->back() == '\r') line->pop_back();
+		return true;
+	}
+};
+
+/**
+	the board size independent part of a game, GameT holds the board
+*/
+struct Game {
+	int index;
+	int first; // which command plays white
+	Engine engines[2]; // white then black
+	std::vector<std::string> record;
+	Clock::time_point deadline;
+
+	bool over = false;
+	int winner = 0; // +1 white, -1 black, 0 draw
+	std::string reason;
+
+	virtual ~Game() { }
+
+	virtual int mover() const = 0;
+	virtual std::string position() const = 0;
+	virtual int boardWinner() const = 0;
+
+	// the reply must be the encoding of a board reachable by one legal move
+	virtual bool applyReply(const std::string& line) = 0;
+
+	int command(int color) const { return color == 0 ? first : 1 - first; }
+
+	void finish(int winner, const std::string& reason) {
+		over = true;
+		this->winner = winner;
+		this->reason = reason;
+		engines[0].stop();
+		engines[1].stop();
+	}
+
+	void forfeit(const std::string& reason) {
+		finish(mover() == 0 ? -1 : 1, (mover() == 0 ? "white " : "black ") + reason);
+	}
+
+	void requestMove(int timeoutMs) {
+		if (!engines[mover()].send(position() + "\n")) {
+			forfeit("hung up");
+			return ;
+		}
+		deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+	}
+
+	bool start(const TournamentOptions& options) {
+		for (int color = 0; color < 2; ++color) {
+			if (!engines[color].start(options.commands[command(color)]))
+				return false;
+		}
+		record.push_back(position());
+		requestMove(options.timeoutMs);
+		return true;
+	}
+
+	void onReadable(const TournamentOptions& options) {
+		Engine& engine = engines[mover()];
+		if (!engine.receive()) {
+			forfeit("crashed");
+			return ;
+		}
+
+		std::string line;
+		while (engine.nextLine(&line)) {
+			// NOTE: engines may chat on stdout, only lines that look like a TBG encoding are taken as moves
+			if (line.empty() || !isdigit(line[0])) continue;
+
+			if (!applyReply(line)) {
+				forfeit("played an illegal move: " + line);
+				return ;
+			}
+			record.push_back(position());
+
+			if (boardWinner() != 0) {
+				finish(boardWinner(), "game over");
+			} else if ((int)record.size() > options.maxPlies) {
+				finish(0, "ply limit");
+			} else {
+				requestMove(options.timeoutMs);
+			}
+			return ;
+		}
+	}
+};
+
+template<int N>
+struct GameT : public Game {
+	BoardT<N> board;
+
+	int mover() const override { return board.playerTurn > 0 ? 0 : 1; }
+	std::string position() const override { return board.toTBGEncoding(); }
+	int boardWinner() const override { return board.getWinner(); }
+
+	bool applyReply(const std::string& line) override {
+		BoardT<N> reply;
+		if (BoardT<N>::parseTBG(line.c_str(), line.length(), &reply) != BoardT<N>::TBG_OK)
+			return false;
+		for (const Move& move : board.get_moves()) {
+			BoardT<N> next = board;
+			move.apply(next);
+			if (next == reply) {
+				board = next;
+				return true;
+			}
+		}
+		return false;
+	}
+};
+
+static Game* newGame(int size) {
+	switch (size) {
+		case 3: return new GameT<3>();
+		case 4: return new GameT<4>();
+		case 5: return new GameT<5>();
+		case 6: return new GameT<6>();
+		case 7: return new GameT<7>();
+		case 8: return new GameT<8>();
+		default: return nullptr;
 	}
-	*buffer = 0;
 }
 
-int main(int argc, const char** argv, const char **envp) {
-	if (argc < 2) {
-		std::cerr << "usage: " << argv[0] << " <proc1> <proc2> " << std::endl;
-		exit(0);
+static void usage(const char *name) {
+	std::cerr << "usage: " << name << " [options] <engine A> <engine B>\n"
+		"\tengines are shell commands that read a TBG board per line and answer with the board after their move\n"
+		"\t-n GAMES    number of games, colors alternate between games (default 2)\n"
+		"\t-c GAMES    games played at once (default 1)\n"
+		"\t-t MS       time limit per move, engines that go over are killed and lose (default 10000)\n"
+		"\t-m PLIES    adjudicate the game as a draw after this many plies (default 400)\n"
+		"\t-s SIZE     board size from 3 to 8 (default 5)\n"
+		"\t-o FILE     write a TBG record of every game to the file\n";
+}
+
+int main(int argc, char **argv) {
+	TournamentOptions options;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "n:c:t:m:s:o:")) != -1) {
+		switch (opt) {
+			case 'n': options.games = atoi(optarg); break;
+			case 'c': options.concurrency = std::max(1, atoi(optarg)); break;
+			case 't': options.timeoutMs = atoi(optarg); break;
+			case 'm': options.maxPlies = atoi(optarg); break;
+			case 's': options.size = atoi(optarg); break;
+			case 'o': options.recordFile = optarg; break;
+			default: usage(argv[0]); return 1;
+		}
+	}
+	if (argc - optind != 2 || options.size < 3 || options.size > 8) {
+		usage(argv[0]);
+		return 1;
+	}
+	options.commands[0] = argv[optind];
+	options.commands[1] = argv[optind + 1];
+
+	// NOTE: a dead engine must not take the tournament down with it when we write to its pipe
+	signal(SIGPIPE, SIG_IGN);
+
+	std::ofstream records;
+	if (!options.recordFile.empty()) {
+		records.open(options.recordFile);
+		if (!records) {
+			std::cerr << "failed to open " << options.recordFile << std::endl;
+			return 1;
+		}
 	}
 
-	int proc1[2];
-	int proc2[2];
+	int wins[2] = {0, 0};
+	int draws = 0;
+	int nextGame = 0;
+	std::vector<std::unique_ptr<Game>> live;
+	std::vector<struct pollfd> fds;
 
-	create_piped_proc(argv[1], proc1);
-	create_piped_proc(argv[2], proc2);
+	while (nextGame < options.games || !live.empty()) {
+		while ((int)live.size() < options.concurrency && nextGame < options.games) {
+			std::unique_ptr<Game> game(newGame(options.size));
+			game->index = nextGame++;
+			game->first = game->index % 2;
+			if (!game->start(options)) {
+				std::cerr << "failed to start engines for game " << game->index + 1 << std::endl;
+				return 1;
+			}
+			live.push_back(std::move(game));
+		}
 
-	char buffer[2048];
+		Clock::time_point now = Clock::now();
+		Clock::time_point deadline = now + std::chrono::milliseconds(options.timeoutMs);
+		fds.clear();
+		for (auto& game : live) {
+			struct pollfd fd;
+			fd.fd = game->engines[game->mover()].out;
+			fd.events = POLLIN;
+			fd.revents = 0;
+			fds.push_back(fd);
+			deadline = std::min(deadline, game->deadline);
+		}
 
-	Board board;
+		int waitMs = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count() + 1;
+		if (poll(fds.data(), fds.size(), std::max(0, waitMs)) < 0 && errno != EINTR) {
+			perror("poll");
+			return 1;
+		}
 
-	while (true) {
-		std::string state;
+		now = Clock::now();
+		for (size_t i = 0; i < live.size(); ++i) {
+			Game& game = *live[i];
+			if (fds[i].revents & (POLLIN | POLLHUP | POLLERR))
+				game.onReadable(options);
+			if (!game.over && now > game.deadline) {
+				game.forfeit("timed out");
+			}
+		}
 
-		state = board.toTBGEncoding() + "\n";
-		write(proc1[0], state.c_str(), state.length());
+		for (auto& game : live) {
+			if (!game->over) continue;
 
-		read_until_newline(proc1[1], buffer);
-		board = Board(std::string(buffer));
-		std::cout << board << std::endl;
-		sleep(1);
+			const int winner = game->winner == 0 ? -1 : game->command(game->winner > 0 ? 0 : 1);
+			if (winner < 0) draws++;
+			else wins[winner]++;
 
-		state = board.toTBGEncoding() + "\n";
-		write(proc2[0], state.c_str(), state.length());
+			std::cout << "game " << game->index + 1 << ": " << (game->first == 0 ? "A" : "B") << " white, "
+				<< (winner < 0 ? "draw" : (winner == 0 ? "A wins" : "B wins"))
+				<< " after " << game->record.size() - 1 << " plies (" << game->reason << ")" << std::endl;
 
-		read_until_newline(proc2[1], buffer);
-		board = Board(std::string(buffer));
-		std::cout << board << std::endl;
-		sleep(1);
+			if (records) {
+				records << "# game " << game->index + 1
+					<< ", white: " << options.commands[game->command(0)]
+					<< ", black: " << options.commands[game->command(1)]
+					<< ", result: " << (game->winner > 0 ? "1-0" : (game->winner < 0 ? "0-1" : "1/2-1/2"))
+					<< " (" << game->reason << ")\n";
+				for (const std::string& position : game->record)
+					records << position << "\n";
+				records << std::endl;
+			}
+		}
+		live.erase(std::remove_if(live.begin(), live.end(),
+			[](const std::unique_ptr<Game>& game) { return game->over; }), live.end());
 	}
+
+	std::cout << "\nA " << wins[0] << " - D " << draws << " - B " << wins[1] << std::endl;
+	return 0;
 }
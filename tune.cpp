@@ -0,0 +1,278 @@
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "eval.h"
+#include "movegen.h"
+#include "ptn.h"
+#include "record.h"
+
+/**
+	texel style tuning of the evaluation weights. every position of a set of finished games is labeled with the
+	result of its game, and the weights are fitted so the win probability of the evaluation predicts the labels, by
+	gradient descent on the log loss. the evaluation of a position is split into its terms once up front (see
+	eval::Terms), after that scoring it under new weights costs a few multiplications.
+*/
+
+typedef std::chrono::steady_clock Clock;
+
+struct TuneOptions {
+	std::string output;
+	std::string start;
+	int skipPlies = 4;
+	int iterations = 1000;
+	double rate = 0.01;
+	double scale = eval::WIN_PROBABILITY_SCALE;
+	int threads = 1;
+};
+
+struct Sample {
+	eval::Terms terms;
+	float result; // 1 if white won, 0 if black won, 0.5 for a draw
+};
+
+// boards whose terms are worked out at once
+const size_t BATCH = 1 << 16;
+
+static void usage(const char *name) {
+	std::cerr << "usage: " << name << " [options] -o WEIGHTS <games>...\n"
+		"\tgames are binary game records, position files labeled with the result or PTN files\n"
+		"\t-w WEIGHTS  weights to start from (default the built in ones)\n"
+		"\t-p PLIES    leave out the first plies of every game (default 4)\n"
+		"\t-i COUNT    iterations of gradient descent (default 1000)\n"
+		"\t-l RATE     learning rate (default 0.01)\n"
+		"\t-k SCALE    score difference per factor of e in the odds of winning (default " << eval::WIN_PROBABILITY_SCALE << ")\n"
+		"\t-j THREADS  threads to score positions with (default: one per core)\n";
+}
+
+static double elapsed(Clock::time_point start) {
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// runs body(begin, end, thread) over the range split between the threads
+template<typename F>
+static void parallel(int threads, size_t count, F body) {
+	const size_t chunk = (count + threads - 1) / threads;
+	std::vector<std::thread> pool;
+	for (int thread = 0; thread * chunk < count; ++thread)
+		pool.push_back(std::thread(body, thread * chunk, std::min(count, (thread + 1) * chunk), thread));
+	for (std::thread& thread : pool)
+		thread.join();
+}
+
+/**
+	collects the labeled positions, the terms of the boards are worked out a batch at a time on every thread
+*/
+class Dataset {
+public:
+	Dataset(int threads) : _threads(threads) { };
+
+	void add(const Board& board, float result) {
+		// NOTE: the evaluation is never asked about a finished game
+		if (board.getWinner() != 0) return ;
+		_boards.push_back(board);
+		_results.push_back(result);
+		if (_boards.size() >= BATCH) flush();
+	}
+
+	void addGame(const Board& start, const uint32_t* moveids, int plies, int result, int skipPlies) {
+		Board board = start;
+		for (int i = 0; i < plies; ++i) {
+			if (i >= skipPlies) add(board, (result + 1) / 2.0f);
+			if (moveids[i] >= movegen::all_moves.size()) return;
+			movegen::all_moves[moveids[i]].apply(board);
+		}
+		if (plies >= skipPlies) add(board, (result + 1) / 2.0f);
+	}
+
+	void flush() {
+		const size_t first = samples.size();
+		samples.resize(first + _boards.size());
+		parallel(_threads, _boards.size(), [&](size_t begin, size_t end, int) {
+			for (size_t i = begin; i < end; ++i) {
+				samples[first + i].terms = eval::terms(_boards[i]);
+				samples[first + i].result = _results[i];
+			}
+		});
+
+		// NOTE: the terms must score exactly like the engine, check the first boards of every batch
+		for (size_t i = 0; i < std::min<size_t>(_boards.size(), 16); ++i)
+			_drift = std::max(_drift, std::abs(eval::score(samples[first + i].terms) - eval::scoreBoard(_boards[i])));
+
+		_boards.clear();
+		_results.clear();
+	}
+
+	// the largest difference seen between scoring the terms and scoring the board
+	double drift() const { return _drift; }
+
+	std::vector<Sample> samples;
+
+private:
+	int _threads;
+	std::vector<Board> _boards;
+	std::vector<float> _results;
+	double _drift = 0;
+};
+
+static bool load(const std::string& path, int skipPlies, Dataset* dataset, int* games) {
+	record::GameReader records;
+	record::PositionReader positions;
+	if (records.open(path)) {
+		record::Game game;
+		std::vector<uint32_t> moveids;
+		while (records.next(&game)) {
+			moveids.assign(game.moveids, game.moveids + game.plies);
+			dataset->addGame(Board(), moveids.data(), moveids.size(), game.result, skipPlies);
+			(*games)++;
+		}
+	} else if (positions.open(path)) {
+		Board board;
+		for (const record::PackedBoard& packed : positions) {
+			if (record::unpack(packed, &board)) dataset->add(board, (packed.result + 1) / 2.0f);
+		}
+	} else {
+		std::ifstream in(path);
+		if (!in) return false;
+		ptn::Reader reader(in);
+		ptn::Game game;
+		while (reader.next(&game)) {
+			if (!game.error.empty()) continue;
+			dataset->addGame(game.start, game.moveids.data(), game.moveids.size(), game.result, skipPlies);
+			(*games)++;
+		}
+	}
+	return true;
+}
+
+// the mean log loss of the weights over the samples, and its gradient if asked for
+static double loss(const std::vector<Sample>& samples, const double* weights, double scale, int threads, double* gradient) {
+	std::vector<double> losses(threads, 0);
+	std::vector<std::vector<double>> gradients(threads, std::vector<double>(eval::WEIGHT_COUNT, 0));
+
+	parallel(threads, samples.size(), [&](size_t begin, size_t end, int thread) {
+		double sum = 0;
+		double terms[eval::WEIGHT_COUNT];
+		std::vector<double>& total = gradients[thread];
+		for (size_t i = begin; i < end; ++i) {
+			const Sample& sample = samples[i];
+			const double p = 1.0 / (1.0 + std::exp(-eval::score(sample.terms, weights) / scale));
+			// NOTE: clamped so a confidently wrong position does not take the loss to infinity
+			const double clamped = std::min(std::max(p, 1e-12), 1 - 1e-12);
+			sum -= sample.result * std::log(clamped) + (1 - sample.result) * std::log(1 - clamped);
+			if (!gradient) continue;
+
+			eval::gradient(sample.terms, weights, terms);
+			const double error = (p - sample.result) / scale;
+			for (int w = 0; w < eval::WEIGHT_COUNT; ++w)
+				total[w] += error * terms[w];
+		}
+		losses[thread] = sum;
+	});
+
+	double sum = 0;
+	for (int thread = 0; thread < threads; ++thread)
+		sum += losses[thread];
+	for (int w = 0; gradient && w < eval::WEIGHT_COUNT; ++w) {
+		gradient[w] = 0;
+		for (int thread = 0; thread < threads; ++thread)
+			gradient[w] += gradients[thread][w] / samples.size();
+	}
+	return sum / samples.size();
+}
+
+/**
+	adam, every weight gets a step size of its own so weights of very different scales move together
+*/
+static void tune(const std::vector<Sample>& samples, const TuneOptions& options, double* weights) {
+	const double BETA1 = 0.9;
+	const double BETA2 = 0.999;
+	const double EPSILON = 1e-8;
+
+	double gradient[eval::WEIGHT_COUNT];
+	double mean[eval::WEIGHT_COUNT] = {};
+	double variance[eval::WEIGHT_COUNT] = {};
+
+	Clock::time_point start = Clock::now();
+	for (int iteration = 1; iteration <= options.iterations; ++iteration) {
+		const double current = loss(samples, weights, options.scale, options.threads, gradient);
+		for (int w = 0; w < eval::WEIGHT_COUNT; ++w) {
+			mean[w] = BETA1 * mean[w] + (1 - BETA1) * gradient[w];
+			variance[w] = BETA2 * variance[w] + (1 - BETA2) * gradient[w] * gradient[w];
+			const double corrected = mean[w] / (1 - std::pow(BETA1, iteration));
+			const double spread = variance[w] / (1 - std::pow(BETA2, iteration));
+			weights[w] -= options.rate * corrected / (std::sqrt(spread) + EPSILON);
+		}
+
+		if (iteration == 1 || iteration % 100 == 0 || iteration == options.iterations) {
+			std::cout << "iteration " << iteration << ": loss " << current << " (" << elapsed(start) << "s)" << std::endl;
+		}
+	}
+}
+
+int main(int argc, char **argv) {
+	TuneOptions options;
+	options.threads = std::max(1u, std::thread::hardware_concurrency());
+
+	int opt;
+	while ((opt = getopt(argc, argv, "o:w:p:i:l:k:j:")) != -1) {
+		switch (opt) {
+			case 'o': options.output = optarg; break;
+			case 'w': options.start = optarg; break;
+			case 'p': options.skipPlies = atoi(optarg); break;
+			case 'i': options.iterations = atoi(optarg); break;
+			case 'l': options.rate = atof(optarg); break;
+			case 'k': options.scale = atof(optarg); break;
+			case 'j': options.threads = std::max(1, atoi(optarg)); break;
+			default: usage(argv[0]); return 1;
+		}
+	}
+	if (options.output.empty() || optind == argc || options.scale <= 0) {
+		usage(argv[0]);
+		return 1;
+	}
+	if (!options.start.empty() && !eval::loadWeights(options.start)) {
+		std::cerr << "failed to load weights from " << options.start << std::endl;
+		return 1;
+	}
+
+	Clock::time_point start = Clock::now();
+	Dataset dataset(options.threads);
+	for (int i = optind; i < argc; ++i) {
+		int games = 0;
+		const size_t before = dataset.samples.size();
+		if (!load(argv[i], options.skipPlies, &dataset, &games)) {
+			std::cerr << "failed to open " << argv[i] << std::endl;
+			return 1;
+		}
+		dataset.flush();
+		std::cout << argv[i] << ": " << games << " games, " << dataset.samples.size() - before << " positions" << std::endl;
+	}
+	if (dataset.samples.empty()) {
+		std::cerr << "no positions to tune on" << std::endl;
+		return 1;
+	}
+	std::cout << dataset.samples.size() << " positions loaded in " << elapsed(start) << "s, largest difference to the "
+		"engine's evaluation " << dataset.drift() << std::endl;
+
+	double weights[eval::WEIGHT_COUNT];
+	std::copy(eval::weights, eval::weights + eval::WEIGHT_COUNT, weights);
+	tune(dataset.samples, options, weights);
+
+	std::cout << "loss " << loss(dataset.samples, eval::weights, options.scale, options.threads, nullptr)
+		<< " -> " << loss(dataset.samples, weights, options.scale, options.threads, nullptr) << std::endl;
+	for (int w = 0; w < eval::WEIGHT_COUNT; ++w)
+		std::cout << "\t" << eval::WEIGHT_NAMES[w] << " " << eval::weights[w] << " -> " << weights[w] << std::endl;
+
+	if (!eval::writeWeights(options.output, weights)) {
+		std::cerr << "failed to write " << options.output << std::endl;
+		return 1;
+	}
+	return 0;
+}